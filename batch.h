@@ -0,0 +1,143 @@
+#ifndef LIBRARYMANAGEMENT_BATCH_H
+#define LIBRARYMANAGEMENT_BATCH_H
+
+#include "storage.h"
+#include "commands.h"
+#include "config.h"
+#include "json.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// One batch line: a JSON object whose "cmd" member holds the command words and whose other members are its flags
+//     {"cmd": "borrow", "book": 5, "borrower": 3}
+//     {"cmd": "add book", "title": "Dune", "author": 2, "genre": "Science Fiction"}
+inline Options parseCommandJson(std::string_view line) {
+    Options command = parseJsonObject(line);
+    std::string words = command.get("cmd");
+    command.values.erase("cmd");
+    std::size_t begin = 0;
+    while ((begin = words.find_first_not_of(' ', begin)) != std::string::npos) {
+        auto end = words.find(' ', begin);
+        command.positional.push_back(words.substr(begin, end - begin));
+        begin = end;
+    }
+    if (command.positional.empty()) {
+        throw std::invalid_argument("missing \"cmd\"");
+    }
+    return command;
+}
+
+struct BatchStats {
+    long long commands = 0;
+    long long applied = 0;
+    long long refused = 0;   // valid commands the library turned down (unknown id, book already out, ...)
+    long long malformed = 0; // lines that are not a command
+    double seconds = 0;
+
+    double commandsPerSecond() const {
+        return seconds > 0 ? commands / seconds : 0;
+    }
+};
+
+// Applies one JSON command per line (blank lines are skipped), committing every `group_size` commands.
+// Each command runs under its own savepoint, so one that fails halfway is undone on its own and the rest of
+// its group still commits. Failures are written to `errors` with their line number; the batch carries on.
+BatchStats runBatchCommands(auto &storage, auto &repo, std::istream &in, std::ostream &errors,
+                            const LoanPolicy &policy, long long group_size = 1000) {
+    auto start = std::chrono::steady_clock::now();
+    sqlite3 *db = storage.get_connection().get();
+    Statement savepoint(db, "SAVEPOINT batch_command");
+    Statement release(db, "RELEASE batch_command");
+    Statement rollbackTo(db, "ROLLBACK TO batch_command");
+    auto run = [](Statement &statement) {
+        statement.step();
+        statement.reset();
+    };
+
+    BatchStats stats;
+    long long lineNumber = 0, pending = 0;
+    std::string line;
+    storage.begin_transaction();
+    try {
+        while (std::getline(in, line)) {
+            ++lineNumber;
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            ++stats.commands;
+            CommandResult result;
+            run(savepoint);
+            try {
+                Options command = parseCommandJson(line);
+                if (!isMutation(command)) {
+                    throw std::invalid_argument("'" + command.positional[0] + "' cannot run in a batch");
+                }
+                result = applyMutation(storage, repo, command, policy);
+            } catch (const std::invalid_argument &e) {
+                result = {ExitUsage, e.what()};
+            } catch (const std::exception &e) {
+                result = refused(e.what());
+            }
+            if (result.status == ExitOk) {
+                ++stats.applied;
+            } else {
+                run(rollbackTo);
+                ++(result.status == ExitUsage ? stats.malformed : stats.refused);
+                errors << "line " << lineNumber << ": " << result.message << '\n';
+            }
+            run(release);
+
+            if (++pending == group_size) {
+                storage.commit();
+                storage.begin_transaction();
+                pending = 0;
+            }
+        }
+        storage.commit();
+    } catch (...) {
+        storage.rollback();
+        throw;
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// `--batch file.jsonl` (or `--batch -` for stdin) with `--group-size N` commands per transaction
+int runBatch(auto &storage, auto &repo, const Options &options, const LoanPolicy &policy) {
+    try {
+        std::string path = options.get("batch");
+        long long group_size = options.getInt("group_size", 1000);
+        if (group_size < 1) {
+            throw std::invalid_argument("Option 'group_size' must be positive");
+        }
+        std::ifstream file;
+        if (path != "-") {
+            file.open(path);
+            if (!file) {
+                std::cerr << "Error: cannot open " << path << '\n';
+                return ExitUsage;
+            }
+        }
+        BatchStats stats = runBatchCommands(storage, repo, path == "-" ? std::cin : file, std::cerr, policy,
+                                            group_size);
+        std::cout << "Applied " << stats.applied << " of " << stats.commands << " commands";
+        if (stats.refused || stats.malformed) {
+            std::cout << " (" << stats.refused << " refused, " << stats.malformed << " malformed)";
+        }
+        std::cout << " in " << stats.seconds << " s (" << static_cast<long long>(stats.commandsPerSecond())
+                  << " commands/s, " << group_size << " per transaction).\n";
+        return stats.applied == stats.commands ? ExitOk : ExitRefused;
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        return ExitRefused;
+    }
+}
+
+#endif //LIBRARYMANAGEMENT_BATCH_H
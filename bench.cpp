@@ -0,0 +1,509 @@
+#include "storage.h"
+#include "repository.h"
+#include "library.h"
+#include "generator.h"
+#include "service.h"
+#include "catalog_cache.h"
+#include "http.h"
+#include "dates.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <streambuf>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+
+using namespace sqlite_orm;
+
+// Benchmarks run against a throwaway database next to the executable.
+const std::string benchDatabase = "library_bench.sqlite";
+
+void resetDatabase(const std::string &path) {
+    for (const auto &suffix: {"", "-wal", "-shm", "-journal"}) {
+        std::filesystem::remove(path + suffix);
+    }
+}
+
+// One author owning `books` books, plus `borrowers` borrowers, so the loans below satisfy the foreign keys.
+void populateCatalog(auto &storage, int books, int borrowers) {
+    storage.transaction([&] {
+        storage.insert(Author{-1, "Bench Author"});
+        auto genre_id = genreIdFor(storage, "Fiction");
+        for (int i = 1; i <= books; ++i) {
+            storage.insert(Book{-1, "Book " + std::to_string(i), 1, genre_id, false});
+        }
+        for (int i = 1; i <= borrowers; ++i) {
+            storage.insert(Borrower{-1, "Borrower " + std::to_string(i), "reader@example.com"});
+        }
+        return true;
+    });
+}
+
+// Fills borrow_records with `rows` loans spread over `books` books and `borrowers` borrowers.
+void populateBorrowRecords(auto &storage, int rows, int books, int borrowers) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> bookDist(1, books);
+    std::uniform_int_distribution<int> borrowerDist(1, borrowers);
+
+    const std::size_t chunk = 1000; // keeps each multi-row insert below SQLite's bound-parameter limit
+    std::vector<BorrowRecord> batch;
+    batch.reserve(chunk);
+
+    storage.transaction([&] {
+        for (int i = 0; i < rows; ++i) {
+            // Roughly one loan in twenty is still open
+            std::optional<int> returned;
+            if (i % 20 != 0) {
+                returned = parseDate("2024-11-10");
+            }
+            batch.push_back(BorrowRecord{-1, bookDist(rng), borrowerDist(rng), parseDate("2024-11-01"), returned});
+            if (batch.size() == chunk) {
+                storage.insert_range(batch.begin(), batch.end());
+                batch.clear();
+            }
+        }
+        if (!batch.empty()) {
+            storage.insert_range(batch.begin(), batch.end());
+        }
+        return true;
+    });
+}
+
+// Average microseconds per call of `lookup(id)` for `iterations` random ids in [1, maxId].
+double timeLookups(int iterations, int maxId, auto lookup) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> idDist(1, maxId);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        lookup(idDist(rng));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+void benchIndexes(int rows) {
+    const int books = 100000;
+    const int borrowers = 20000;
+    const int iterations = 200;
+
+    resetDatabase(benchDatabase);
+    auto storage = createStorage(benchDatabase);
+    openStorage(storage, StorageProfile{});
+    storage.sync_schema();
+
+    std::cout << "Populating " << rows << " borrow records...\n";
+    populateCatalog(storage, books, borrowers);
+    populateBorrowRecords(storage, rows, books, borrowers);
+
+    auto byBook = [&](int id) {
+        return storage.template get_all<BorrowRecord>(where(c(&BorrowRecord::book_id) == id));
+    };
+    auto byBorrower = [&](int id) {
+        return storage.template get_all<BorrowRecord>(where(c(&BorrowRecord::borrower_id) == id));
+    };
+    auto openByBook = [&](int id) {
+        return storage.template get_all<BorrowRecord>(
+            where(c(&BorrowRecord::book_id) == id and is_null(&BorrowRecord::return_date)));
+    };
+
+    // Before: the schema as it was, primary keys only
+    storage.drop_index("idx_borrow_records_book_id");
+    storage.drop_index("idx_borrow_records_borrower_id");
+    storage.drop_index("idx_borrow_records_open");
+    storage.drop_index("idx_books_author_id");
+    double bookScan = timeLookups(iterations, books, byBook);
+    double borrowerScan = timeLookups(iterations, borrowers, byBorrower);
+    double openScan = timeLookups(iterations, books, openByBook);
+
+    // After: sync_schema recreates the declared indexes
+    storage.sync_schema();
+    double bookIndexed = timeLookups(iterations, books, byBook);
+    double borrowerIndexed = timeLookups(iterations, borrowers, byBorrower);
+    double openIndexed = timeLookups(iterations, books, openByBook);
+
+    auto report = [](const std::string &name, double before, double after) {
+        std::cout << name << ": " << before << " us -> " << after << " us ("
+                  << before / after << "x)\n";
+    };
+    std::cout << "\nLookup latency at " << rows << " borrow records (avg of " << iterations << " lookups)\n";
+    report("Loans by book_id", bookScan, bookIndexed);
+    report("Loans by borrower_id", borrowerScan, borrowerIndexed);
+    report("Open loans by book_id", openScan, openIndexed);
+}
+
+// Calls per second of `operation(id)` for `iterations` random ids in [1, maxId].
+double opsPerSecond(int iterations, int maxId, auto operation) {
+    return 1e6 / timeLookups(iterations, maxId, operation);
+}
+
+void benchPreparedStatements(int rows) {
+    const int books = 100000;
+    const int borrowers = 20000;
+    const int iterations = 100000;
+
+    resetDatabase(benchDatabase);
+    auto storage = createStorage(benchDatabase);
+    openStorage(storage, StorageProfile{});
+    storage.sync_schema();
+
+    std::cout << "Populating " << books << " books, " << borrowers << " borrowers and "
+              << rows << " borrow records...\n";
+    populateCatalog(storage, books, borrowers);
+    populateBorrowRecords(storage, rows, books, borrowers);
+
+    Repository repo(storage);
+
+    auto report = [](const std::string &name, double uncached, double cached) {
+        std::cout << name << ": " << static_cast<long long>(uncached) << " ops/s -> "
+                  << static_cast<long long>(cached) << " ops/s (" << cached / uncached << "x)\n";
+    };
+    std::cout << "\nThroughput with and without the statement cache (" << iterations << " calls each)\n";
+    report("Book by id",
+           opsPerSecond(iterations, books, [&](int id) { return storage.template get_optional<Book>(id); }),
+           opsPerSecond(iterations, books, [&](int id) { return repo.book(id); }));
+    report("Borrower by id",
+           opsPerSecond(iterations, borrowers, [&](int id) { return storage.template get_optional<Borrower>(id); }),
+           opsPerSecond(iterations, borrowers, [&](int id) { return repo.borrower(id); }));
+    report("Loans by book",
+           opsPerSecond(iterations, books, [&](int id) {
+               return storage.template get_all<BorrowRecord>(where(c(&BorrowRecord::book_id) == id));
+           }),
+           opsPerSecond(iterations, books, [&](int id) { return repo.loansByBook(id); }));
+    report("Loans by borrower",
+           opsPerSecond(iterations, borrowers, [&](int id) {
+               return storage.template get_all<BorrowRecord>(where(c(&BorrowRecord::borrower_id) == id));
+           }),
+           opsPerSecond(iterations, borrowers, [&](int id) { return repo.loansByBorrower(id); }));
+}
+
+// Swallows everything written to it, so listings are timed without terminal I/O but still format every row.
+class DiscardBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override {
+        return ch;
+    }
+
+    std::streamsize xsputn(const char *, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Latency distribution of one operation, in microseconds per call
+struct OperationResult {
+    std::string name;
+    std::vector<double> samples;
+    double seconds = 0;
+};
+
+double percentile(std::vector<double> sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// Runs `operation(i)` for i in [0, iterations), timing each call separately.
+OperationResult timeOperation(const std::string &name, long long iterations,
+                              const std::function<void(long long)> &operation) {
+    std::cout << "  " << name << " x" << iterations << "...\n";
+    OperationResult result{name, {}, 0};
+    result.samples.reserve(static_cast<std::size_t>(iterations));
+    for (long long i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        operation(i);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.samples.push_back(elapsed * 1e6);
+        result.seconds += elapsed;
+    }
+    return result;
+}
+
+// Library shape for a given number of loans: ten loans per book, fifty per borrower, ten books per author.
+DatasetSpec benchSpec(long long loans, std::uint64_t seed) {
+    DatasetSpec spec;
+    spec.loans = loans;
+    spec.books = std::max<long long>(loans / 10, 1);
+    spec.borrowers = std::max<long long>(loans / 50, 1);
+    spec.authors = std::max<long long>(loans / 100, 1);
+    spec.seed = seed;
+    return spec;
+}
+
+// Generates a fresh library of `loans` borrow records and times every storage operation behind the menus,
+// the destructive ones last. Listings walk the whole library, so they get fewer iterations.
+void benchOperations(long long loans, const Options &options, std::ostream &json) {
+    long long iterations = options.getInt("iterations", 1000);
+    long long listIterations = options.getInt("list_iterations", 5);
+    auto spec = benchSpec(loans, static_cast<std::uint64_t>(options.getInt("seed", 42)));
+
+    resetDatabase(benchDatabase);
+    auto storage = createStorage(benchDatabase);
+    openStorage(storage, profileFromOptions(options));
+    storage.sync_schema();
+
+    std::cout << "Generating " << spec.loans << " loans over " << spec.books << " books, " << spec.borrowers
+              << " borrowers and " << spec.authors << " authors...\n";
+    auto dataset = createTestData(storage, spec);
+    Repository repo(storage);
+
+    DiscardBuffer discard;
+    std::ostream sink(&discard);
+    std::mt19937_64 rng(spec.seed + 1);
+    auto randomId = [&rng](long long max) {
+        return static_cast<int>(1 + rng() % static_cast<std::uint64_t>(max));
+    };
+    int current_date = today();
+    // A genre the generator seeded, so the genre listing walks the index instead of missing the name
+    auto genres = storage.template get_all<Genre>(order_by(&Genre::id), limit(1));
+    if (genres.empty()) {
+        throw std::runtime_error("the generated library has no genres");
+    }
+    std::string genre = genres.front().name;
+
+    std::vector<OperationResult> results;
+    results.push_back(timeOperation("listBooks", listIterations, [&](long long) { listBooks(storage, sink); }));
+    results.push_back(timeOperation("listBooksByGenre", listIterations, [&](long long) {
+        listBooksByGenre(storage, genre, sink);
+    }));
+    results.push_back(timeOperation("listGenreCounts", listIterations, [&](long long) {
+        listGenreCounts(storage, sink);
+    }));
+    results.push_back(timeOperation("listAuthorsAndBooks", listIterations, [&](long long) {
+        listAuthorsAndBooks(storage, sink);
+    }));
+    results.push_back(timeOperation("listBorrowers", listIterations, [&](long long) {
+        listBorrowers(storage, sink);
+    }));
+    results.push_back(timeOperation("lookupBook", iterations, [&](long long) { repo.book(randomId(spec.books)); }));
+    {
+        // The cache is loaded before timing starts and dropped before the writes below
+        CatalogCache catalog(storage);
+        results.push_back(timeOperation("listBooks(catalog cache)", listIterations, [&](long long) {
+            listBooks(catalog, sink);
+        }));
+        results.push_back(timeOperation("lookupBook(catalog cache)", iterations, [&](long long) {
+            catalog.book(randomId(spec.books));
+        }));
+        catalog.report(std::cout);
+    }
+    results.push_back(timeOperation("showBorrowRecords", listIterations, [&](long long) {
+        streamBorrowRecords(storage, RecordFilter{}, sink);
+    }));
+    results.push_back(timeOperation("showBorrowRecords(borrower)", iterations, [&](long long) {
+        streamBorrowRecords(storage, RecordFilter{randomId(spec.borrowers), 0, {}, {}}, sink);
+    }));
+
+    // Each checkout and return is its own transaction, as at the desk. Books already out are skipped by the
+    // conditional UPDATE, which is part of what is being measured.
+    std::vector<int> checkedOut;
+    results.push_back(timeOperation("borrowBook", iterations, [&](long long) {
+        int book_id = randomId(spec.books);
+        storage.transaction([&] {
+            if (checkoutBook(storage, book_id, randomId(spec.borrowers), current_date,
+                             current_date + spec.loan_days) == CheckoutResult::Ok) {
+                checkedOut.push_back(book_id);
+            }
+            return true;
+        });
+    }));
+    results.push_back(timeOperation("returnBook", static_cast<long long>(checkedOut.size()), [&](long long i) {
+        storage.transaction([&] {
+            returnByBookId(storage, repo, checkedOut[static_cast<std::size_t>(i)], current_date);
+            return true;
+        });
+    }));
+
+    // Deletes take distinct ids from the front of each table; a book's loans and an author's books cascade
+    results.push_back(timeOperation("removeBook", std::min(iterations, spec.books), [&](long long i) {
+        storage.transaction([&] {
+            deleteBook(storage, static_cast<int>(i + 1));
+            return true;
+        });
+    }));
+    results.push_back(timeOperation("removeAuthor", std::min(iterations, spec.authors), [&](long long i) {
+        storage.transaction([&] {
+            deleteAuthor(storage, static_cast<int>(i + 1));
+            return true;
+        });
+    }));
+
+    json << "    {\"loans\": " << spec.loans << ", \"books\": " << spec.books << ", \"borrowers\": " << spec.borrowers
+         << ", \"authors\": " << spec.authors << ", \"rows\": " << dataset.rows
+         << ", \"generate_seconds\": " << dataset.seconds << ",\n     \"operations\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto &result = results[i];
+        auto count = static_cast<double>(result.samples.size());
+        json << "       {\"name\": \"" << result.name << "\", \"iterations\": " << result.samples.size()
+             << ", \"p50_us\": " << percentile(result.samples, 0.50)
+             << ", \"p99_us\": " << percentile(result.samples, 0.99)
+             << ", \"mean_us\": " << (count ? result.seconds * 1e6 / count : 0)
+             << ", \"ops_per_sec\": " << (result.seconds > 0 ? count / result.seconds : 0) << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    json << "     ]}";
+}
+
+// Load test of the serve mode: the service runs in-process on an ephemeral loopback port against a generated
+// library, and `clients` threads drive it over keep-alive connections with a desk-like mix of 80% book
+// lookups, 10% checkouts and 10% returns. A worker serves one connection at a time, so clients beyond the
+// worker count would only queue; the default is one client per worker.
+void benchService(const Options &options, std::ostream &json) {
+    auto spec = benchSpec(options.getInt("loans", 1000000), static_cast<std::uint64_t>(options.getInt("seed", 42)));
+    int threads = static_cast<int>(options.getInt("threads", std::max(2u, std::thread::hardware_concurrency())));
+    int clients = static_cast<int>(options.getInt("clients", threads));
+    long long requests = options.getInt("requests", 20000); // per client
+    StorageProfile profile = profileFromOptions(options);
+    CommitWindow window = commitWindowFromOptions(options);
+
+    resetDatabase(benchDatabase);
+    {
+        auto storage = createStorage(benchDatabase);
+        openStorage(storage, profile);
+        storage.sync_schema();
+        std::cout << "Generating " << spec.loans << " loans over " << spec.books << " books...\n";
+        createTestData(storage, spec);
+    }
+
+    HttpServer server(0, threads, serviceHandlers(benchDatabase, profile, LoanPolicy{}, threads, window));
+    server.start();
+    std::cout << "Service on port " << server.port() << " with " << threads << " workers; " << clients
+              << " clients x " << requests << " requests...\n";
+
+    const char *names[] = {"GET /books/{id}", "POST /borrow", "POST /return"};
+    struct ClientResult {
+        std::vector<double> samples[3];
+        long long conflicts[3] = {};
+        long long errors[3] = {};
+    };
+    std::vector<ClientResult> results(static_cast<std::size_t>(clients));
+    std::vector<std::thread> clientThreads;
+    auto start = std::chrono::steady_clock::now();
+    for (int client = 0; client < clients; ++client) {
+        clientThreads.emplace_back([&, client] {
+            auto &result = results[static_cast<std::size_t>(client)];
+            std::mt19937_64 rng(spec.seed + 100 + static_cast<std::uint64_t>(client));
+            auto randomId = [&rng](long long max) {
+                return std::to_string(1 + rng() % static_cast<std::uint64_t>(max));
+            };
+            HttpClient http(server.port());
+            for (long long i = 0; i < requests; ++i) {
+                auto roll = rng() % 10;
+                int kind = roll < 8 ? 0 : roll == 8 ? 1 : 2;
+                auto begin = std::chrono::steady_clock::now();
+                HttpResponse response;
+                if (kind == 0) {
+                    response = http.request("GET", "/books/" + randomId(spec.books));
+                } else if (kind == 1) {
+                    response = http.request("POST", "/borrow", "{\"book\": " + randomId(spec.books) +
+                                                               ", \"borrower\": " + randomId(spec.borrowers) + "}");
+                } else {
+                    response = http.request("POST", "/return", "{\"book\": " + randomId(spec.books) + "}");
+                }
+                auto elapsed = std::chrono::steady_clock::now() - begin;
+                result.samples[kind].push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+                if (response.status == 409) {
+                    ++result.conflicts[kind];
+                } else if (response.status >= 400) {
+                    ++result.errors[kind];
+                }
+            }
+        });
+    }
+    for (auto &thread: clientThreads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    server.stop();
+
+    json << "{\"benchmark\": \"service\", \"loans\": " << spec.loans << ", \"workers\": " << threads
+         << ", \"clients\": " << clients << ", \"commit_window_ms\": " << window.wait.count()
+         << ", \"commit_max_ops\": " << window.max_ops << ", \"requests\": " << requests * clients
+         << ", \"seconds\": " << seconds
+         << ", \"requests_per_sec\": " << requests * clients / seconds << ",\n \"operations\": [\n";
+    for (int kind = 0; kind < 3; ++kind) {
+        std::vector<double> samples;
+        long long conflicts = 0, errors = 0;
+        for (const auto &result: results) {
+            samples.insert(samples.end(), result.samples[kind].begin(), result.samples[kind].end());
+            conflicts += result.conflicts[kind];
+            errors += result.errors[kind];
+        }
+        json << "   {\"name\": \"" << names[kind] << "\", \"requests\": " << samples.size()
+             << ", \"p50_us\": " << percentile(samples, 0.50) << ", \"p99_us\": " << percentile(samples, 0.99)
+             << ", \"conflicts\": " << conflicts << ", \"errors\": " << errors << "}" << (kind < 2 ? ",\n" : "\n");
+    }
+    json << " ]}\n" << std::flush;
+}
+
+// Comma-separated row counts, e.g. "10000,1000000"
+std::vector<long long> parseScales(const std::string &text) {
+    std::vector<long long> scales;
+    std::size_t begin = 0;
+    while (begin <= text.size()) {
+        auto end = std::min(text.find(',', begin), text.size());
+        scales.push_back(std::stoll(text.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    return scales;
+}
+
+constexpr const char *benchUsage =
+    "Usage: librarymanagement_bench [operations|indexes|statements|all] [--scales 10000,1000000,10000000]\n"
+    "                               [--iterations 1000] [--list-iterations 5] [--rows 1000000] [--seed 42]\n"
+    "       librarymanagement_bench service [--loans 1000000] [--threads N] [--clients N] [--requests 20000]\n"
+    "                               [--commit-window-ms 2] [--commit-max-ops 256]\n";
+
+// The operations and service suites print their reports as JSON on stdout; progress and the other suites go to
+// stderr. An unknown suite is a usage error, so a script never mistakes a typo for a run.
+int main(int argc, char *argv[]) {
+    Options options;
+    std::string suite;
+    std::streambuf *report = std::cout.rdbuf();
+    std::cout.rdbuf(std::cerr.rdbuf());
+    std::ostream json(report);
+    try {
+        parseArguments(argc, argv, options);
+        suite = options.positional.empty() ? "operations" : options.positional[0];
+        if (suite != "operations" && suite != "service" && suite != "indexes" && suite != "statements" &&
+            suite != "all") {
+            std::cerr << "Error: unknown suite '" << suite << "'\n" << benchUsage;
+            std::cout.rdbuf(report);
+            return ExitUsage;
+        }
+        int rows = static_cast<int>(options.getInt("rows", 1000000));
+        if (suite == "operations" || suite == "all") {
+            json << "{\"benchmark\": \"operations\", \"results\": [\n";
+            auto scales = parseScales(options.get("scales", "10000,1000000,10000000"));
+            for (std::size_t i = 0; i < scales.size(); ++i) {
+                benchOperations(scales[i], options, json);
+                json << (i + 1 < scales.size() ? ",\n" : "\n");
+            }
+            json << "]}\n" << std::flush;
+        }
+        if (suite == "service") {
+            benchService(options, json);
+        }
+        if (suite == "indexes" || suite == "all") {
+            benchIndexes(rows);
+        }
+        if (suite == "statements" || suite == "all") {
+            benchPreparedStatements(rows);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        std::cout.rdbuf(report);
+        return 1;
+    }
+    std::cout.rdbuf(report);
+    resetDatabase(benchDatabase);
+    return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef LIBRARYMANAGEMENT_BULK_IMPORT_H
+#define LIBRARYMANAGEMENT_BULK_IMPORT_H
+
+#include "storage.h"
+#include <istream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <optional>
+#include <chrono>
+#include <charconv>
+#include <stdexcept>
+
+struct ImportStats {
+    long long lines = 0;
+    long long books = 0;
+    long long authors_created = 0;
+    long long skipped = 0;
+    double seconds = 0;
+
+    double rowsPerSecond() const {
+        return seconds > 0 ? books / seconds : 0;
+    }
+};
+
+// More copies than any real shelf holds; a line asking for more is a typo or a garbled field, and is skipped as
+// malformed rather than inserting millions of rows
+constexpr long long maxImportCopies = 1000;
+
+// Splits "a, b, c" into at most `max` trimmed fields without allocating.
+inline int splitFields(std::string_view line, std::string_view *fields, int max) {
+    int count = 0;
+    while (count < max) {
+        auto comma = count + 1 < max ? line.find(',') : std::string_view::npos;
+        auto field = line.substr(0, comma);
+        auto begin = field.find_first_not_of(" \t\r");
+        auto end = field.find_last_not_of(" \t\r");
+        fields[count++] = begin == std::string_view::npos ? std::string_view{} : field.substr(begin, end - begin + 1);
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        line.remove_prefix(comma + 1);
+    }
+    return count;
+}
+
+// Streams a catalog in the books.txt format, one title per line:
+//     Title, copies, code[, author[, genre]]
+// Each copy becomes one books row. The code column is the shelf shortcut used by the sample file and has no
+// column in the schema, so it is read and ignored. Authors are resolved (or created) through an in-memory map
+// primed from the authors table; lines without an author go to "Unknown". Genres are resolved the same way, and
+// lines without a genre leave it null.
+// All rows go through one prepared INSERT, committed once a batch reaches `batch_size` rows, always at the end
+// of a line. If the import fails, the error names the failing line and the last line already committed, so a
+// rerun can start from the line after it.
+ImportStats importBooks(auto &storage, std::istream &in, long long batch_size = 100000) {
+    auto start = std::chrono::steady_clock::now();
+    sqlite3 *db = storage.get_connection().get();
+    ImportStats stats;
+
+    std::unordered_map<std::string, int> authorIds;
+    {
+        Statement authors(db, "SELECT id, name FROM authors");
+        while (authors.step()) {
+            authorIds.emplace(authors.columnText(1), static_cast<int>(authors.columnInt(0)));
+        }
+    }
+
+    std::unordered_map<std::string, int> genreIds;
+    {
+        Statement genres(db, "SELECT id, name FROM genres");
+        while (genres.step()) {
+            genreIds.emplace(genres.columnText(1), static_cast<int>(genres.columnInt(0)));
+        }
+    }
+
+    Statement insertBook(db, "INSERT INTO books (title, author_id, genre_id, is_borrowed) VALUES (?, ?, ?, 0)");
+    Statement insertAuthor(db, "INSERT INTO authors (name) VALUES (?)");
+    Statement insertGenre(db, "INSERT INTO genres (name) VALUES (?)");
+
+    auto resolveAuthor = [&](std::string_view name) {
+        std::string key(name.empty() ? "Unknown" : name);
+        auto it = authorIds.find(key);
+        if (it != authorIds.end()) {
+            return it->second;
+        }
+        insertAuthor.bind(1, key).step();
+        insertAuthor.reset();
+        ++stats.authors_created;
+        int id = static_cast<int>(sqlite3_last_insert_rowid(db));
+        authorIds.emplace(std::move(key), id);
+        return id;
+    };
+
+    auto resolveGenre = [&](std::string_view name) -> std::optional<int> {
+        if (name.empty()) {
+            return std::nullopt;
+        }
+        std::string key(name);
+        auto it = genreIds.find(key);
+        if (it != genreIds.end()) {
+            return it->second;
+        }
+        insertGenre.bind(1, key).step();
+        insertGenre.reset();
+        int id = static_cast<int>(sqlite3_last_insert_rowid(db));
+        genreIds.emplace(std::move(key), id);
+        return id;
+    };
+
+    long long committedLines = 0, committedBooks = 0;
+    storage.begin_transaction();
+    try {
+        long long pending = 0;
+        std::string line, title;
+        std::string_view fields[5];
+        while (std::getline(in, line)) {
+            ++stats.lines;
+            int count = splitFields(line, fields, 5);
+            long long copies = 0;
+            if (count >= 2 && !fields[0].empty()) {
+                std::from_chars(fields[1].data(), fields[1].data() + fields[1].size(), copies);
+            }
+            if (copies <= 0 || copies > maxImportCopies) {
+                ++stats.skipped;
+                continue;
+            }
+
+            int authorId = resolveAuthor(count >= 4 ? fields[3] : std::string_view{});
+            std::optional<int> genreId = resolveGenre(count >= 5 ? fields[4] : std::string_view{});
+            title.assign(fields[0]);
+            for (long long copy = 0; copy < copies; ++copy) {
+                insertBook.bind(1, title).bind(2, authorId).bind(3, genreId).step();
+                insertBook.reset();
+                ++stats.books;
+            }
+            pending += copies;
+            if (pending >= batch_size) {
+                storage.commit();
+                storage.begin_transaction();
+                pending = 0;
+                committedLines = stats.lines;
+                committedBooks = stats.books;
+            }
+        }
+        storage.commit();
+    } catch (const std::exception &e) {
+        storage.rollback();
+        throw std::runtime_error("import stopped at line " + std::to_string(stats.lines) + ": " + e.what() +
+                                 "; lines 1-" + std::to_string(committedLines) + " (" +
+                                 std::to_string(committedBooks) + " books) were committed");
+    } catch (...) {
+        storage.rollback();
+        throw;
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+#endif //LIBRARYMANAGEMENT_BULK_IMPORT_H
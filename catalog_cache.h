@@ -0,0 +1,283 @@
+#ifndef LIBRARYMANAGEMENT_CATALOG_CACHE_H
+#define LIBRARYMANAGEMENT_CATALOG_CACHE_H
+
+#include "storage.h"
+#include "library.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Heap memory owned by a cached row beyond its sizeof
+inline std::size_t heapBytes(const std::string &text) {
+    return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+}
+
+inline std::size_t heapBytes(const Book &book) {
+    return heapBytes(book.title);
+}
+
+inline std::size_t heapBytes(const Genre &genre) {
+    return heapBytes(genre.name);
+}
+
+inline std::size_t heapBytes(const Author &author) {
+    return heapBytes(author.name);
+}
+
+// Rows kept sorted by id in one contiguous vector: a lookup is a binary search, a listing is a walk in id order,
+// and there is no per-entry node or bucket overhead. Updating a row in place is cheap, and so is adding a row
+// with the highest id (an append). Erasing a row, or adding one below the highest id, shifts every later row
+// (O(n)). That suits a catalog that is read far more often than rows are deleted, and a bulk change reloads
+// the whole catalog instead.
+template<class T>
+class FlatMap {
+public:
+    const T *find(int id) const {
+        auto it = lowerBound(rows, id);
+        return it != rows.end() && it->id == id ? &*it : nullptr;
+    }
+
+    void put(T row) {
+        auto it = lowerBound(rows, row.id);
+        if (it != rows.end() && it->id == row.id) {
+            *it = std::move(row);
+        } else {
+            rows.insert(it, std::move(row));
+        }
+    }
+
+    void erase(int id) {
+        auto it = lowerBound(rows, id);
+        if (it != rows.end() && it->id == id) {
+            rows.erase(it);
+        }
+    }
+
+    // `sorted` must be ordered by id, as an ORDER BY id query returns it
+    void assign(std::vector<T> sorted) {
+        rows = std::move(sorted);
+        rows.shrink_to_fit();
+    }
+
+    const std::vector<T> &all() const {
+        return rows;
+    }
+
+    // The vector plus every string that outgrew its inline buffer
+    std::size_t bytes() const {
+        std::size_t total = rows.capacity() * sizeof(T);
+        for (const auto &row: rows) {
+            total += heapBytes(row);
+        }
+        return total;
+    }
+
+private:
+    template<class Rows>
+    static auto lowerBound(Rows &rows, int id) {
+        return std::lower_bound(rows.begin(), rows.end(), id, [](const T &row, int key) { return row.id < key; });
+    }
+
+    std::vector<T> rows;
+};
+
+// Optional in-memory copy of the catalog (books, authors and genre names) for sessions that list and look up
+// books far more often than they change them (--catalog-cache, or "catalog_cache = 1" in the config file).
+//
+// Writes on this connection are caught by sqlite3_update_hook, whatever code made them, and the rows they
+// touched are re-read at the next sync(). Commits by other connections bump PRAGMA data_version, and the whole
+// catalog is reloaded. Inside a transaction the cache steps aside and reads go to SQLite, so it never holds
+// rows that could still be rolled back.
+template<class S>
+class CatalogCache {
+public:
+    S &storage;
+
+    explicit CatalogCache(S &storage)
+        : storage(storage), db(storage.get_connection().get()), dataVersionStmt(db, "PRAGMA data_version") {
+        sqlite3_update_hook(db, &CatalogCache::rowChanged, this);
+        load();
+    }
+
+    ~CatalogCache() {
+        sqlite3_update_hook(db, nullptr, nullptr);
+    }
+
+    CatalogCache(const CatalogCache &) = delete;
+    CatalogCache &operator=(const CatalogCache &) = delete;
+
+    // Brings the cache up to date before a read. Returns false inside a transaction, where the caller must read
+    // SQLite instead. A read counts as a hit only when it did not have to reload the catalog first.
+    bool sync() {
+        if (!sqlite3_get_autocommit(db)) {
+            ++misses;
+            return false;
+        }
+        // Re-reading row by row only pays while few rows changed; a bulk import reloads instead
+        std::size_t dirty = dirtyBooks.size() + dirtyAuthors.size() + dirtyGenres.size();
+        if (dataVersion() != loadedVersion || dirty > bookRows.all().size() / 8 + 1024) {
+            ++misses;
+            load();
+            return true;
+        }
+        ++hits;
+        refresh(bookRows, dirtyBooks);
+        refresh(authorRows, dirtyAuthors);
+        refresh(genreRows, dirtyGenres);
+        return true;
+    }
+
+    std::optional<Book> book(int id) {
+        return lookup(bookRows, id);
+    }
+
+    std::optional<Author> author(int id) {
+        return lookup(authorRows, id);
+    }
+
+    // "" for a book without a genre; current as of the last sync()
+    std::string genreName(const std::optional<int> &genre_id) {
+        if (!genre_id) {
+            return "";
+        }
+        auto genre = lookup(genreRows, *genre_id);
+        return genre ? genre->name : "";
+    }
+
+    // Whole tables in id order; current as of the last sync() that returned true
+    const FlatMap<Book> &books() const {
+        return bookRows;
+    }
+
+    const FlatMap<Author> &authors() const {
+        return authorRows;
+    }
+
+    const FlatMap<Genre> &genres() const {
+        return genreRows;
+    }
+
+    void report(std::ostream &out) const {
+        long long reads = hits + misses;
+        auto bytes = bookRows.bytes() + authorRows.bytes() + genreRows.bytes() +
+                     (dirtyBooks.capacity() + dirtyAuthors.capacity() + dirtyGenres.capacity()) * sizeof(int);
+        out << "Catalog cache: " << bookRows.all().size() << " books, " << authorRows.all().size() << " authors in "
+            << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB; "
+            << (reads ? 100.0 * hits / reads : 0.0) << "% hit rate (" << hits << " of " << reads
+            << " reads without a reload), " << reloads << " reloads, " << rowsReread << " rows re-read\n"
+            << std::defaultfloat;
+    }
+
+private:
+    // A lookup outside a transaction is always answered from memory; "not found" is an answer too
+    template<class T>
+    std::optional<T> lookup(FlatMap<T> &rows, int id) {
+        if (!sync()) {
+            return storage.template get_optional<T>(id);
+        }
+        const T *row = rows.find(id);
+        return row ? std::optional<T>(*row) : std::nullopt;
+    }
+
+    long long dataVersion() {
+        dataVersionStmt.step();
+        long long version = dataVersionStmt.columnInt(0);
+        dataVersionStmt.reset();
+        return version;
+    }
+
+    // One read transaction, so books and authors come from the same snapshot as the version they are filed under
+    void load() {
+        storage.transaction([&] {
+            loadedVersion = dataVersion();
+            bookRows.assign(storage.template get_all<Book>(order_by(&Book::id)));
+            authorRows.assign(storage.template get_all<Author>(order_by(&Author::id)));
+            genreRows.assign(storage.template get_all<Genre>(order_by(&Genre::id)));
+            return true;
+        });
+        dirtyBooks.clear();
+        dirtyAuthors.clear();
+        dirtyGenres.clear();
+        ++reloads;
+    }
+
+    template<class T>
+    void refresh(FlatMap<T> &rows, std::vector<int> &dirty) {
+        std::sort(dirty.begin(), dirty.end());
+        dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+        for (int id: dirty) {
+            if (auto row = storage.template get_optional<T>(id)) {
+                rows.put(std::move(*row));
+            } else {
+                rows.erase(id);
+            }
+            ++rowsReread;
+        }
+        dirty.clear();
+    }
+
+    // Runs inside SQLite's write path, so it only notes the id; it must not touch the connection
+    static void rowChanged(void *self, int, const char *, const char *table, sqlite3_int64 rowid) {
+        auto &cache = *static_cast<CatalogCache *>(self);
+        if (std::strcmp(table, "books") == 0) {
+            cache.dirtyBooks.push_back(static_cast<int>(rowid));
+        } else if (std::strcmp(table, "authors") == 0) {
+            cache.dirtyAuthors.push_back(static_cast<int>(rowid));
+        } else if (std::strcmp(table, "genres") == 0) {
+            cache.dirtyGenres.push_back(static_cast<int>(rowid));
+        }
+    }
+
+    sqlite3 *db;
+    Statement dataVersionStmt;
+    long long loadedVersion = 0;
+    FlatMap<Book> bookRows;
+    FlatMap<Author> authorRows;
+    FlatMap<Genre> genreRows;
+    std::vector<int> dirtyBooks;
+    std::vector<int> dirtyAuthors;
+    std::vector<int> dirtyGenres;
+    long long hits = 0;
+    long long misses = 0;
+    long long reloads = 0;
+    long long rowsReread = 0;
+};
+
+// listBooks() and listAuthors() served from the cache, with the same output
+template<class S>
+void listBooks(CatalogCache<S> &catalog, std::ostream &out = std::cout) {
+    if (!catalog.sync()) {
+        listBooks(catalog.storage, out);
+        return;
+    }
+    const auto &authors = catalog.authors();
+    const auto &genres = catalog.genres();
+    for (const auto &book: catalog.books().all()) {
+        const Author *author = authors.find(book.author_id);
+        const Genre *genre = book.genre_id ? genres.find(*book.genre_id) : nullptr;
+        out << "ID: " << book.id
+            << ", Title: " << book.title
+            << ", Author: " << (author ? author->name : "Unknown")
+            << ", Genre: " << (genre ? genre->name : "")
+            << ", Borrowed: " << (book.is_borrowed ? "Yes" : "No") << '\n';
+    }
+}
+
+template<class S>
+void listAuthors(CatalogCache<S> &catalog, std::ostream &out = std::cout) {
+    if (!catalog.sync()) {
+        listAuthors(catalog.storage, out);
+        return;
+    }
+    for (const auto &author: catalog.authors().all()) {
+        out << "ID: " << author.id << ", Name: " << author.name << '\n';
+    }
+}
+
+#endif //LIBRARYMANAGEMENT_CATALOG_CACHE_H
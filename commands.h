@@ -0,0 +1,438 @@
+#ifndef LIBRARYMANAGEMENT_COMMANDS_H
+#define LIBRARYMANAGEMENT_COMMANDS_H
+
+#include "storage.h"
+#include "library.h"
+#include "config.h"
+#include "dates.h"
+#include "bulk_import.h"
+#include "csv_export.h"
+#include "generator.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Non-interactive commands: every menu action as `librarymanagement <command> [--flags]` on one opened storage.
+// A command is an Options value whose positional words name the action ("add", "book") and whose flags carry
+// the arguments (--title, --author), the same shape parseArguments() produces for the whole command line.
+
+constexpr const char *commandUsage =
+    "Usage: librarymanagement [options] <command>\n"
+    "  add book --title T --author ID [--genre G]\n"
+    "  add author --name N\n"
+    "  add borrower --name N --email E\n"
+    "  update book --id ID [--title T] [--author ID] [--genre G]\n"
+    "  remove book --id ID | remove author --id ID\n"
+    "  borrow --book ID --borrower ID [--date D] [--due D]\n"
+    "  return --book ID | --record ID [--date D]\n"
+    "  list books|authors|borrowers|loans|overdue|records|genres [--format text|tsv]\n"
+    "       (books: [--genre G]; records: [--borrower ID] [--book ID] [--from D] [--to D])\n"
+    "  import <file> | export [file] | generate [--books N ...]\n"
+    "  serve [--port 8080] [--threads N]   JSON over HTTP on 127.0.0.1\n"
+    "       [--commit-window-ms 2] [--commit-max-ops 256]   group commit for writes\n"
+    "  --batch <file.jsonl | -> [--group-size N]\n"
+    "       one {\"cmd\": \"borrow\", \"book\": 5, \"borrower\": 3} per line, N commands per transaction\n"
+    "Dates are DD-MM-YYYY or YYYY-MM-DD.\n";
+
+// Process exit codes
+enum ExitStatus {
+    ExitOk = 0,
+    ExitRefused = 1, // well-formed, but not carried out: unknown id, book already out, database error
+    ExitUsage = 2    // unknown command or bad arguments
+};
+
+// Outcome of one command, printed by the caller (or collected, for a batch)
+struct CommandResult {
+    int status = ExitOk;
+    std::string message;
+};
+
+inline CommandResult refused(const std::string &message) {
+    return {ExitRefused, message};
+}
+
+// Argument helpers; a missing or malformed argument is a usage error (std::invalid_argument)
+inline int idOption(const Options &command, const std::string &key) {
+    long long id = command.getInt(key, 0);
+    if (id <= 0 || id > std::numeric_limits<int>::max()) {
+        throw std::invalid_argument("--" + key + " expects a positive ID");
+    }
+    return static_cast<int>(id);
+}
+
+inline std::string requiredOption(const Options &command, const std::string &key) {
+    if (command.get(key).empty()) {
+        throw std::invalid_argument("--" + key + " is required");
+    }
+    return command.get(key);
+}
+
+inline std::optional<int> dateOption(const Options &command, const std::string &key) {
+    if (!command.has(key)) {
+        return std::nullopt;
+    }
+    auto date = parseDate(command.get(key));
+    if (!date) {
+        throw std::invalid_argument("--" + key + " expects a date as DD-MM-YYYY or YYYY-MM-DD");
+    }
+    return date;
+}
+
+inline bool isMutation(const Options &command) {
+    static const std::vector<std::string> verbs = {"add", "update", "remove", "borrow", "return"};
+    return !command.positional.empty() &&
+           std::find(verbs.begin(), verbs.end(), command.positional[0]) != verbs.end();
+}
+
+// Carries out one add/update/remove/borrow/return command. The caller owns the transaction, so a batch can
+// apply many commands in one commit; a refused command has changed nothing.
+CommandResult applyMutation(auto &storage, auto &repo, const Options &command, const LoanPolicy &policy) {
+    const auto &words = command.positional;
+    std::string action = words.empty() ? "" : words[0];
+    std::string target = words.size() == 2 ? words[1] : "";
+
+    if (action == "borrow" && words.size() == 1) {
+        int book_id = idOption(command, "book");
+        int borrower_id = idOption(command, "borrower");
+        int borrow_date = dateOption(command, "date").value_or(today());
+        int due_date = dateOption(command, "due").value_or(borrow_date + policy.loan_days);
+        if (!repo.borrower(borrower_id)) {
+            return refused("Borrower with ID " + std::to_string(borrower_id) + " not found.");
+        }
+        switch (checkoutBook(storage, book_id, borrower_id, borrow_date, due_date)) {
+            case CheckoutResult::Ok:
+                return {ExitOk, "Book " + std::to_string(book_id) + " borrowed, due back on " +
+                                formatDate(due_date) + "."};
+            case CheckoutResult::AlreadyBorrowed:
+                return refused("Book " + std::to_string(book_id) + " is already borrowed.");
+            case CheckoutResult::BookNotFound:
+                break;
+        }
+        return refused("Book with ID " + std::to_string(book_id) + " not found.");
+    }
+    if (action == "return" && words.size() == 1) {
+        int return_date = dateOption(command, "date").value_or(today());
+        if (command.has("record")) {
+            int record_id = idOption(command, "record");
+            auto record = repo.borrowRecord(record_id);
+            if (!record || !closeLoan(storage, record->id, record->book_id, return_date)) {
+                return refused("Borrow ID " + std::to_string(record_id) + " is not an open loan.");
+            }
+            return {ExitOk, "Borrow ID " + std::to_string(record_id) + " returned on " + formatDate(return_date) + "."};
+        }
+        int book_id = idOption(command, "book");
+        if (!returnByBookId(storage, repo, book_id, return_date)) {
+            return refused("Book ID " + std::to_string(book_id) + " is not currently borrowed.");
+        }
+        return {ExitOk, "Book " + std::to_string(book_id) + " returned on " + formatDate(return_date) + "."};
+    }
+    if (action == "add" && target == "book") {
+        // The foreign key on books.author_id rejects an unknown author
+        std::string title = requiredOption(command, "title");
+        int author_id = idOption(command, "author");
+        int id = storage.insert(Book{-1, title, author_id, genreIdFor(storage, command.get("genre")), false});
+        return {ExitOk, "Added book ID " + std::to_string(id) + "."};
+    }
+    if (action == "add" && target == "author") {
+        int id = storage.insert(Author{-1, requiredOption(command, "name")});
+        return {ExitOk, "Added author ID " + std::to_string(id) + "."};
+    }
+    if (action == "add" && target == "borrower") {
+        int id = storage.insert(Borrower{-1, requiredOption(command, "name"), requiredOption(command, "email")});
+        return {ExitOk, "Registered borrower ID " + std::to_string(id) + "."};
+    }
+    if (action == "update" && target == "book") {
+        int book_id = idOption(command, "id");
+        auto book = repo.book(book_id);
+        if (!book) {
+            return refused("Book with ID " + std::to_string(book_id) + " not found.");
+        }
+        if (command.has("title")) {
+            book->title = requiredOption(command, "title");
+        }
+        if (command.has("author")) {
+            book->author_id = idOption(command, "author");
+        }
+        if (command.has("genre")) {
+            book->genre_id = genreIdFor(storage, command.get("genre"));
+        }
+        storage.update(*book);
+        return {ExitOk, "Updated book ID " + std::to_string(book_id) + "."};
+    }
+    if (action == "remove" && target == "book") {
+        int book_id = idOption(command, "id");
+        DeleteCounts counts = deleteBook(storage, book_id);
+        if (counts.books == 0) {
+            return refused("Book with ID " + std::to_string(book_id) + " not found.");
+        }
+        return {ExitOk, "Removed book ID " + std::to_string(book_id) + " and " +
+                        std::to_string(counts.borrow_records) + " borrow records."};
+    }
+    if (action == "remove" && target == "author") {
+        int author_id = idOption(command, "id");
+        if (authorHasBorrowedBooks(storage, author_id)) {
+            return refused("Cannot delete author " + std::to_string(author_id) + ": some of their books are borrowed.");
+        }
+        DeleteCounts counts = deleteAuthor(storage, author_id);
+        if (counts.authors == 0) {
+            return refused("Author with ID " + std::to_string(author_id) + " not found.");
+        }
+        return {ExitOk, "Removed author ID " + std::to_string(author_id) + ", " + std::to_string(counts.books) +
+                        " books and " + std::to_string(counts.borrow_records) + " borrow records."};
+    }
+    std::string name;
+    for (const auto &word: words) {
+        name += (name.empty() ? "" : " ") + word;
+    }
+    throw std::invalid_argument("Unknown command '" + name + "'");
+}
+
+// Writes every row of `rows` as tab-separated values under a header of the column names. Tabs and line
+// breaks inside values become spaces so each row stays one line.
+inline void writeTsv(Statement &rows, std::ostream &out) {
+    std::string line;
+    auto append = [&line](std::string value) {
+        std::replace_if(value.begin(), value.end(), [](char ch) { return ch == '\t' || ch == '\n' || ch == '\r'; },
+                        ' ');
+        line += value;
+    };
+    for (int i = 0; i < rows.columnCount(); ++i) {
+        line += i ? "\t" : "";
+        append(rows.columnName(i));
+    }
+    out << line << '\n';
+    while (rows.step()) {
+        line.clear();
+        for (int i = 0; i < rows.columnCount(); ++i) {
+            line += i ? "\t" : "";
+            append(rows.columnText(i));
+        }
+        out << line << '\n';
+    }
+    out.flush();
+}
+
+// Joined loan columns shared by the loan listings, dates as YYYY-MM-DD
+inline std::string loanColumnsSql() {
+    return "SELECT r.id, r.book_id, COALESCE(b.title, 'Unknown') AS title, r.borrower_id, "
+           "COALESCE(w.name, 'Unknown') AS borrower, " + isoDateSql("r.borrow_date") + " AS borrow_date, " +
+           isoDateSql("r.due_date") + " AS due_date, " + isoDateSql("r.return_date") + " AS return_date "
+           "FROM borrow_records r "
+           "LEFT JOIN books b ON b.id = r.book_id "
+           "LEFT JOIN borrowers w ON w.id = r.borrower_id ";
+}
+
+// `list <what> [--format text|tsv]`. Text is what the menus print; tsv has a header row and is meant for scripts.
+int runList(auto &storage, const Options &command, std::ostream &out) {
+    const auto &words = command.positional;
+    std::string what = words.size() == 2 ? words[1] : "";
+    std::string format = command.get("format", "text");
+    if (format != "text" && format != "tsv") {
+        throw std::invalid_argument("--format expects text or tsv");
+    }
+    RecordFilter filter{static_cast<int>(command.getInt("borrower", 0)), static_cast<int>(command.getInt("book", 0)),
+                        dateOption(command, "from"), dateOption(command, "to")};
+    int current_date = today();
+    sqlite3 *db = storage.get_connection().get();
+
+    if (format == "text") {
+        if (what == "books" && command.has("genre")) {
+            if (!listBooksByGenre(storage, command.get("genre"), out)) {
+                out << "No genre named '" << command.get("genre") << "'.\n";
+            }
+        } else if (what == "books") {
+            listBooks(storage, out);
+        } else if (what == "genres") {
+            listGenreCounts(storage, out);
+        } else if (what == "authors") {
+            listAuthorsAndBooks(storage, out);
+        } else if (what == "borrowers") {
+            listBorrowers(storage, out);
+        } else if (what == "loans") {
+            listOpenLoans(storage, out);
+        } else if (what == "overdue") {
+            writeOverdueLoans(storage, current_date, out);
+        } else if (what == "records") {
+            streamBorrowRecords(storage, filter, out);
+        } else {
+            throw std::invalid_argument("Unknown listing '" + what + "'");
+        }
+        return ExitOk;
+    }
+
+    if (what == "books") {
+        // A genre filter resolves the name once and then walks the integer index on books.genre_id
+        std::string genre = command.get("genre");
+        std::string sql = "SELECT b.id, b.title, COALESCE(a.name, 'Unknown') AS author, "
+                          "COALESCE(g.name, '') AS genre, b.is_borrowed AS borrowed "
+                          "FROM books b LEFT JOIN authors a ON a.id = b.author_id "
+                          "LEFT JOIN genres g ON g.id = b.genre_id ";
+        if (command.has("genre")) {
+            sql += "WHERE b.genre_id = (SELECT id FROM genres WHERE name = ?) ";
+        }
+        Statement rows(db, sql + "ORDER BY b.id");
+        if (command.has("genre")) {
+            rows.bind(1, genre);
+        }
+        writeTsv(rows, out);
+    } else if (what == "genres") {
+        Statement rows(db, "SELECT g.id, g.name, COALESCE(c.books, 0) AS books FROM genres g "
+                           "LEFT JOIN (SELECT genre_id, COUNT(*) AS books FROM books GROUP BY genre_id) c "
+                           "ON c.genre_id = g.id ORDER BY g.name");
+        writeTsv(rows, out);
+    } else if (what == "authors") {
+        Statement rows(db, "SELECT a.id, a.name, "
+                           "(SELECT COUNT(*) FROM books b WHERE b.author_id = a.id) AS books "
+                           "FROM authors a ORDER BY a.id");
+        writeTsv(rows, out);
+    } else if (what == "borrowers") {
+        Statement rows(db, "SELECT w.id, w.name, w.email, "
+                           "(SELECT COUNT(*) FROM borrow_records r WHERE r.borrower_id = w.id "
+                           "AND r.return_date IS NULL) AS open_loans "
+                           "FROM borrowers w ORDER BY w.id");
+        writeTsv(rows, out);
+    } else if (what == "loans") {
+        Statement rows(db, loanColumnsSql() + "WHERE r.return_date IS NULL ORDER BY r.id");
+        writeTsv(rows, out);
+    } else if (what == "overdue") {
+        Statement rows(db, loanColumnsSql() + "WHERE r.return_date IS NULL AND r.due_date < ? ORDER BY r.due_date");
+        rows.bind(1, current_date);
+        writeTsv(rows, out);
+    } else if (what == "records") {
+        // Only the filters that are set become predicates, each answered by an index on borrow_records
+        std::string sql = loanColumnsSql() + "WHERE 1";
+        std::vector<long long> values;
+        auto add = [&](const std::string &predicate, long long value) {
+            sql += " AND " + predicate;
+            values.push_back(value);
+        };
+        if (filter.borrower_id) {
+            add("r.borrower_id = ?", filter.borrower_id);
+        }
+        if (filter.book_id) {
+            add("r.book_id = ?", filter.book_id);
+        }
+        if (filter.borrowed_from) {
+            add("r.borrow_date >= ?", *filter.borrowed_from);
+        }
+        if (filter.borrowed_to) {
+            add("r.borrow_date <= ?", *filter.borrowed_to);
+        }
+        Statement rows(db, sql + " ORDER BY r.id");
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            rows.bind(static_cast<int>(i + 1), values[i]);
+        }
+        writeTsv(rows, out);
+    } else {
+        throw std::invalid_argument("Unknown listing '" + what + "'");
+    }
+    return ExitOk;
+}
+
+// Loads a catalog file in the books.txt format ("Title, copies, code[, author[, genre]]")
+bool runImport(auto &storage, const std::string &path) {
+    try {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Error: cannot open " << path << '\n';
+            return false;
+        }
+        ImportStats stats = importBooks(storage, file);
+        std::cout << "Imported " << stats.books << " books (" << stats.authors_created << " new authors) from "
+                  << stats.lines << " lines in " << stats.seconds << " s ("
+                  << static_cast<long long>(stats.rowsPerSecond()) << " rows/s)";
+        if (stats.skipped) {
+            std::cout << ", skipped " << stats.skipped << " malformed lines";
+        }
+        std::cout << ".\n";
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        return false;
+    }
+}
+
+bool runExport(auto &storage, const std::string &path) {
+    try {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: cannot write " << path << '\n';
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        long long rows = exportCirculation(storage, file);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Exported " << rows << " books to " << path << " in " << seconds << " s.\n";
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        return false;
+    }
+}
+
+// Fills the database with a reproducible synthetic library for profiling, e.g.
+// `librarymanagement generate --authors 100000 --books 5000000 --borrowers 1000000 --loans 50000000 --seed 7`
+bool runGenerate(auto &storage, const Options &options) {
+    try {
+        DatasetSpec spec = datasetSpecFromOptions(options);
+        std::cout << "Generating " << spec.authors << " authors, " << spec.books << " books, " << spec.borrowers
+                  << " borrowers and " << spec.loans << " loans (seed " << spec.seed << ")...\n";
+        DatasetStats stats = createTestData(storage, spec);
+        std::cout << "Inserted " << stats.rows << " rows (" << stats.open_loans << " open loans) in "
+                  << stats.seconds << " s (" << static_cast<long long>(stats.rows / std::max(stats.seconds, 1e-9))
+                  << " rows/s).\n";
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        return false;
+    }
+}
+
+// Runs the command named by the positional arguments and returns the process exit status.
+// Each mutation is its own transaction, committed only when the command succeeded.
+int runCommand(auto &storage, auto &repo, const Options &options, const LoanPolicy &policy) {
+    const auto &args = options.positional;
+    try {
+        if (args[0] == "help") {
+            std::cout << commandUsage;
+            return ExitOk;
+        }
+        if (args[0] == "import" && args.size() == 2) {
+            return runImport(storage, args[1]) ? ExitOk : ExitRefused;
+        }
+        if (args[0] == "export" && args.size() <= 2) {
+            return runExport(storage, args.size() == 2 ? args[1] : "export_book.txt") ? ExitOk : ExitRefused;
+        }
+        if (args[0] == "generate" && args.size() == 1) {
+            return runGenerate(storage, options) ? ExitOk : ExitRefused;
+        }
+        if (args[0] == "list") {
+            return runList(storage, options, std::cout);
+        }
+        if (isMutation(options)) {
+            CommandResult result;
+            storage.transaction([&] {
+                result = applyMutation(storage, repo, options, policy);
+                return result.status == ExitOk;
+            });
+            (result.status == ExitOk ? std::cout : std::cerr) << result.message << '\n';
+            return result.status;
+        }
+        throw std::invalid_argument("Unknown command '" + args[0] + "'");
+    } catch (const std::invalid_argument &e) {
+        std::cerr << "Error: " << e.what() << "\n" << commandUsage;
+        return ExitUsage;
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        return ExitRefused;
+    }
+}
+
+#endif //LIBRARYMANAGEMENT_COMMANDS_H
@@ -0,0 +1,135 @@
+#ifndef LIBRARYMANAGEMENT_CONFIG_H
+#define LIBRARYMANAGEMENT_CONFIG_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cctype>
+#include <cmath>
+
+// Settings gathered from the command line and the config file, keyed by option name.
+// "--cache-size 1000", "--cache-size=1000" and "cache_size = 1000" in the file all set "cache_size".
+struct Options {
+    std::map<std::string, std::string> values;
+    std::vector<std::string> positional;
+
+    bool has(const std::string &key) const {
+        return values.contains(key);
+    }
+
+    std::string get(const std::string &key, const std::string &fallback = "") const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : it->second;
+    }
+
+    long long getInt(const std::string &key, long long fallback) const {
+        auto it = values.find(key);
+        if (it == values.end()) {
+            return fallback;
+        }
+        try {
+            return std::stoll(it->second);
+        } catch (const std::exception &) {
+            throw std::invalid_argument("Option '" + key + "' expects a number, got '" + it->second + "'");
+        }
+    }
+
+    double getDouble(const std::string &key, double fallback) const {
+        auto it = values.find(key);
+        if (it == values.end()) {
+            return fallback;
+        }
+        std::size_t end = 0;
+        double value = 0;
+        try {
+            value = std::stod(it->second, &end);
+        } catch (const std::exception &) {
+        }
+        if (end == 0 || end != it->second.size() || std::isnan(value)) {
+            throw std::invalid_argument("Option '" + key + "' expects a number, got '" + it->second + "'");
+        }
+        return value;
+    }
+};
+
+// Options that never take a value, so a positional argument after them is not taken as their value.
+inline const std::set<std::string> &switchOptions() {
+    static const std::set<std::string> switches = {"help", "profile_queries", "catalog_cache"};
+    return switches;
+}
+
+inline std::string trimmed(const std::string &text) {
+    auto begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    auto end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+inline std::string optionKey(std::string name) {
+    std::replace(name.begin(), name.end(), '-', '_');
+    return name;
+}
+
+// Command-line values win over the config file, so this runs first.
+inline void parseArguments(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0 || arg.size() == 2) {
+            options.positional.push_back(arg);
+            continue;
+        }
+        arg = arg.substr(2);
+        auto eq = arg.find('=');
+        if (eq != std::string::npos) {
+            options.values[optionKey(arg.substr(0, eq))] = arg.substr(eq + 1);
+            continue;
+        }
+        std::string key = optionKey(arg);
+        if (!switchOptions().contains(key) && i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0) {
+            options.values[key] = argv[++i];
+        } else {
+            options.values[key] = "1";
+        }
+    }
+}
+
+// Reads "key = value" lines ('#' starts a comment). Keys already set on the command line are kept.
+// Returns false when the file cannot be opened.
+inline bool loadConfigFile(const std::string &path, Options &options) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        line = trimmed(line.substr(0, line.find('#')));
+        auto eq = line.find('=');
+        if (line.empty() || eq == std::string::npos) {
+            continue;
+        }
+        options.values.try_emplace(optionKey(trimmed(line.substr(0, eq))), trimmed(line.substr(eq + 1)));
+    }
+    return true;
+}
+
+// Circulation rules read from the same options ("loan_days = 21" or --loan-days 21)
+struct LoanPolicy {
+    int loan_days = 14;
+};
+
+inline LoanPolicy loanPolicyFromOptions(const Options &options) {
+    LoanPolicy policy;
+    policy.loan_days = static_cast<int>(options.getInt("loan_days", policy.loan_days));
+    if (policy.loan_days <= 0) {
+        throw std::invalid_argument("Option 'loan_days' must be positive");
+    }
+    return policy;
+}
+
+#endif //LIBRARYMANAGEMENT_CONFIG_H
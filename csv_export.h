@@ -0,0 +1,72 @@
+#ifndef LIBRARYMANAGEMENT_CSV_EXPORT_H
+#define LIBRARYMANAGEMENT_CSV_EXPORT_H
+
+#include "storage.h"
+#include "dates.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Appends `field` to `out` as a CSV field, quoted (with doubled quotes) only when it contains a separator,
+// a quote or a line break.
+inline void appendCsvField(std::string &out, std::string_view field) {
+    if (field.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(field);
+        return;
+    }
+    out.push_back('"');
+    for (char ch: field) {
+        if (ch == '"') {
+            out.push_back('"');
+        }
+        out.push_back(ch);
+    }
+    out.push_back('"');
+}
+
+// Writes the circulation state in the export_book.txt layout, one row per book with its most recent loan:
+//     book_id,book_name,author_name,borrowed/available,borrow_date,return_date,borrower_name
+// One joined query is stepped row by row into a 1 MiB buffer, so memory stays flat however many loans exist.
+// The latest loan is picked with MAX(id) per book, which the borrow_records(book_id) index answers directly.
+// Returns the number of rows written.
+long long exportCirculation(auto &storage, std::ostream &out) {
+    constexpr std::size_t bufferSize = 1 << 20;
+    Statement rows(storage.get_connection().get(),
+                   "SELECT b.id, b.title, COALESCE(a.name, 'Unknown'), b.is_borrowed, "
+                   "r.id, r.borrow_date, r.return_date, COALESCE(w.name, 'Unknown') "
+                   "FROM books b "
+                   "LEFT JOIN authors a ON a.id = b.author_id "
+                   "LEFT JOIN borrow_records r ON r.id = (SELECT MAX(id) FROM borrow_records WHERE book_id = b.id) "
+                   "LEFT JOIN borrowers w ON w.id = r.borrower_id "
+                   "ORDER BY b.id");
+
+    std::string buffer;
+    buffer.reserve(bufferSize);
+    buffer += "book_id,book_name,author_name,borrowed/available,borrow_date,return_date,borrower_name\n";
+    long long count = 0;
+    while (rows.step()) {
+        bool hasLoan = !rows.isNull(4);
+        buffer += std::to_string(rows.columnInt(0));
+        buffer.push_back(',');
+        appendCsvField(buffer, rows.columnText(1));
+        buffer.push_back(',');
+        appendCsvField(buffer, rows.columnText(2));
+        buffer += rows.columnInt(3) ? ",borrowed," : ",available,";
+        buffer += hasLoan && !rows.isNull(5) ? formatDate(static_cast<int>(rows.columnInt(5))) : "N/A";
+        buffer.push_back(',');
+        buffer += hasLoan && !rows.isNull(6) ? formatDate(static_cast<int>(rows.columnInt(6))) : "N/A";
+        buffer.push_back(',');
+        appendCsvField(buffer, hasLoan ? rows.columnText(7) : "N/A");
+        buffer.push_back('\n');
+        ++count;
+        if (buffer.size() > bufferSize - 4096) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+    return count;
+}
+
+#endif //LIBRARYMANAGEMENT_CSV_EXPORT_H
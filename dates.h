@@ -0,0 +1,98 @@
+#ifndef LIBRARYMANAGEMENT_DATES_H
+#define LIBRARYMANAGEMENT_DATES_H
+
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+// Dates are stored as whole days since 1970-01-01 (SQLite: julianday(d) - 2440587.5), so they sort and
+// range-scan as plain integers. Text only exists at the display and input edges.
+
+inline int toEpochDays(int year, unsigned month, unsigned day) {
+    using namespace std::chrono;
+    return static_cast<int>(sys_days{std::chrono::year{year} / std::chrono::month{month} / std::chrono::day{day}}
+        .time_since_epoch().count());
+}
+
+// Today's local date
+inline int today() {
+    auto time_t_now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm local_time;
+#ifdef _WIN32
+    localtime_s(&local_time, &time_t_now);
+#else
+    localtime_r(&time_t_now, &local_time);
+#endif
+    return toEpochDays(local_time.tm_year + 1900, local_time.tm_mon + 1, local_time.tm_mday);
+}
+
+// DD-MM-YYYY, the format the desks have always seen
+inline std::string formatDate(int days) {
+    using namespace std::chrono;
+    year_month_day date{sys_days{std::chrono::days{days}}};
+    char text[16];
+    std::snprintf(text, sizeof text, "%02u-%02u-%04d", static_cast<unsigned>(date.day()),
+                  static_cast<unsigned>(date.month()), static_cast<int>(date.year()));
+    return text;
+}
+
+// YYYY-MM-DD, for machine-readable output
+inline std::string formatIsoDate(int days) {
+    using namespace std::chrono;
+    year_month_day date{sys_days{std::chrono::days{days}}};
+    char text[16];
+    std::snprintf(text, sizeof text, "%04d-%02u-%02u", static_cast<int>(date.year()),
+                  static_cast<unsigned>(date.month()), static_cast<unsigned>(date.day()));
+    return text;
+}
+
+inline std::string formatDate(const std::optional<int> &days, const std::string &fallback) {
+    return days ? formatDate(*days) : fallback;
+}
+
+// Accepts DD-MM-YYYY and YYYY-MM-DD; nullopt for anything else or an impossible date
+inline std::optional<int> parseDate(const std::string &text) {
+    int year = 0;
+    unsigned month = 0, day = 0;
+    char sep1 = 0, sep2 = 0;
+    if (text.size() == 10 && text[4] == '-') {
+        std::sscanf(text.c_str(), "%4d%c%2u%c%2u", &year, &sep1, &month, &sep2, &day);
+    } else if (text.size() == 10 && text[2] == '-') {
+        std::sscanf(text.c_str(), "%2u%c%2u%c%4d", &day, &sep1, &month, &sep2, &year);
+    }
+    if (sep1 != '-' || sep2 != '-') {
+        return std::nullopt;
+    }
+    std::chrono::year_month_day date{std::chrono::year{year}, std::chrono::month{month}, std::chrono::day{day}};
+    if (!date.ok()) {
+        return std::nullopt;
+    }
+    return toEpochDays(year, month, day);
+}
+
+// SQL expression converting a legacy text date column (DD-MM-YYYY or YYYY-MM-DD) to epoch days;
+// integers pass through and anything unparseable becomes NULL. julianday() would roll an impossible date such as
+// 31-02-2024 over into March, so a date only converts if the day it lands on prints back as the same text.
+inline std::string epochDaysSql(const std::string &column) {
+    auto converted = [](const std::string &iso) {
+        return "CASE WHEN date(julianday(" + iso + ")) = " + iso +
+               " THEN CAST(julianday(" + iso + ") - 2440587.5 AS INTEGER) END";
+    };
+    return "CASE"
+           " WHEN typeof(" + column + ") = 'integer' THEN " + column +
+           " WHEN " + column + " GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]*'"
+           " THEN " + converted("substr(" + column + ", 1, 10)") +
+           " WHEN " + column + " GLOB '[0-9][0-9]-[0-9][0-9]-[0-9][0-9][0-9][0-9]*'"
+           " THEN " + converted("(substr(" + column + ", 7, 4) || '-' || substr(" + column + ", 4, 2) || '-' || "
+                                "substr(" + column + ", 1, 2))") +
+           " END";
+}
+
+// SQL expression rendering an epoch-day column as YYYY-MM-DD (NULL stays NULL)
+inline std::string isoDateSql(const std::string &column) {
+    return "date(" + column + " * 86400, 'unixepoch')";
+}
+
+#endif //LIBRARYMANAGEMENT_DATES_H
@@ -0,0 +1,219 @@
+#ifndef LIBRARYMANAGEMENT_GENERATOR_H
+#define LIBRARYMANAGEMENT_GENERATOR_H
+
+#include "storage.h"
+#include "config.h"
+#include "dates.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Cardinalities and shape of a synthetic library. The same seed always produces the same database.
+struct DatasetSpec {
+    long long authors = 1000;
+    long long books = 50000;
+    long long borrowers = 10000;
+    long long loans = 500000;
+    double open_ratio = 0.05;   // share of the loans still out, capped at one per book
+    double zipf = 1.0;          // popularity skew of books (and of authors' output); 0 is uniform
+    int history_days = 5 * 365; // returned loans are spread over this many past days
+    int loan_days = 14;
+    std::uint64_t seed = 42;
+    long long batch_size = 100000; // rows per transaction
+};
+
+inline DatasetSpec datasetSpecFromOptions(const Options &options) {
+    DatasetSpec spec;
+    spec.authors = options.getInt("authors", spec.authors);
+    spec.books = options.getInt("books", spec.books);
+    spec.borrowers = options.getInt("borrowers", spec.borrowers);
+    spec.loans = options.getInt("loans", spec.loans);
+    spec.open_ratio = options.getDouble("open_ratio", spec.open_ratio);
+    spec.zipf = options.getDouble("zipf", spec.zipf);
+    spec.history_days = static_cast<int>(options.getInt("history_days", spec.history_days));
+    spec.loan_days = static_cast<int>(options.getInt("loan_days", spec.loan_days));
+    spec.seed = static_cast<std::uint64_t>(options.getInt("seed", static_cast<long long>(spec.seed)));
+    spec.batch_size = options.getInt("batch_size", spec.batch_size);
+    if (spec.authors < 1 || spec.books < 0 || spec.borrowers < 1 || spec.loans < 0 || spec.batch_size < 1) {
+        throw std::invalid_argument("Dataset sizes must be positive");
+    }
+    if (spec.open_ratio < 0 || spec.open_ratio > 1) {
+        throw std::invalid_argument("Option 'open_ratio' must be between 0 and 1");
+    }
+    if (spec.zipf < 0) {
+        throw std::invalid_argument("Option 'zipf' must not be negative");
+    }
+    return spec;
+}
+
+// Draws ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s. mt19937_64's output is fixed by the
+// standard, unlike the std distributions, so a seed gives the same data on every platform.
+class ZipfSampler {
+public:
+    ZipfSampler(long long n, double s) : cumulative(static_cast<std::size_t>(n)) {
+        double total = 0;
+        for (long long rank = 0; rank < n; ++rank) {
+            total += 1.0 / std::pow(static_cast<double>(rank + 1), s);
+            cumulative[static_cast<std::size_t>(rank)] = total;
+        }
+        for (auto &value: cumulative) {
+            value /= total;
+        }
+    }
+
+    long long operator()(std::mt19937_64 &rng) const {
+        double u = static_cast<double>(rng() >> 11) * 0x1.0p-53;
+        auto it = std::upper_bound(cumulative.begin(), cumulative.end(), u);
+        return std::min<long long>(it - cumulative.begin(), static_cast<long long>(cumulative.size()) - 1);
+    }
+
+private:
+    std::vector<double> cumulative;
+};
+
+struct DatasetStats {
+    long long rows = 0;
+    long long open_loans = 0;
+    double seconds = 0;
+};
+
+// Populates the library with a reproducible synthetic dataset: authors with Zipf-skewed output, books with
+// Zipf-skewed popularity, a returned loan history and a share of open (some overdue) loans that keeps
+// books.is_borrowed consistent. Rows are appended through raw prepared statements in batched transactions.
+DatasetStats createTestData(auto &storage, const DatasetSpec &spec) {
+    static const char *genres[] = {"Fantasy", "Dystopian", "Science Fiction", "Mystery", "Romance", "History",
+                                   "Biography", "Poetry", "Children", "Reference", "Thriller", "Philosophy"};
+    auto start = std::chrono::steady_clock::now();
+    sqlite3 *db = storage.get_connection().get();
+    std::mt19937_64 rng(spec.seed);
+    auto below = [&rng](long long n) {
+        return static_cast<long long>(rng() % static_cast<std::uint64_t>(n));
+    };
+    int current_date = today();
+    DatasetStats stats;
+
+    long long pending = 0;
+    auto counted = [&] {
+        ++stats.rows;
+        if (++pending == spec.batch_size) {
+            storage.commit();
+            storage.begin_transaction();
+            pending = 0;
+            // Progress goes to stderr so a redirected stdout holds only the summary
+            std::cerr << "  " << stats.rows << " rows...\r" << std::flush;
+        }
+    };
+
+    // Which books are out right now, decided up front so books.is_borrowed can be written in one pass
+    ZipfSampler bookPopularity(std::max<long long>(spec.books, 1), spec.zipf);
+    std::vector<bool> borrowed(static_cast<std::size_t>(spec.books), false);
+    long long openTarget = spec.books ? std::min(spec.books, static_cast<long long>(spec.loans * spec.open_ratio)) : 0;
+    for (long long attempts = 0; stats.open_loans < openTarget && attempts < openTarget * 20; ++attempts) {
+        auto book = static_cast<std::size_t>(bookPopularity(rng));
+        if (!borrowed[book]) {
+            borrowed[book] = true;
+            ++stats.open_loans;
+        }
+    }
+
+    Statement insertAuthor(db, "INSERT INTO authors (name) VALUES (?)");
+    Statement insertGenre(db, "INSERT OR IGNORE INTO genres (name) VALUES (?)");
+    Statement genreId(db, "SELECT id FROM genres WHERE name = ?");
+    Statement insertBook(db, "INSERT INTO books (title, author_id, genre_id, is_borrowed) VALUES (?, ?, ?, ?)");
+    Statement insertBorrower(db, "INSERT INTO borrowers (name, email) VALUES (?, ?)");
+    Statement insertLoan(db, "INSERT INTO borrow_records (book_id, borrower_id, borrow_date, return_date, due_date) "
+                             "VALUES (?, ?, ?, ?, ?)");
+
+    storage.begin_transaction();
+    try {
+        std::string name, email;
+        long long firstAuthor = 0, firstBook = 0, firstBorrower = 0;
+
+        // The genre names may already be there from an earlier run
+        std::vector<long long> genreIds;
+        for (const char *genre: genres) {
+            name = genre;
+            insertGenre.bind(1, name).step();
+            insertGenre.reset();
+            genreId.bind(1, name).step();
+            genreIds.push_back(genreId.columnInt(0));
+            genreId.reset();
+        }
+
+        for (long long i = 0; i < spec.authors; ++i) {
+            name = "Author " + std::to_string(i + 1);
+            insertAuthor.bind(1, name).step();
+            insertAuthor.reset();
+            firstAuthor = i == 0 ? sqlite3_last_insert_rowid(db) : firstAuthor;
+            counted();
+        }
+
+        ZipfSampler authorOutput(spec.authors, spec.zipf);
+        for (long long i = 0; i < spec.books; ++i) {
+            name = "Book " + std::to_string(i + 1);
+            long long genre = genreIds[static_cast<std::size_t>(below(std::size(genres)))];
+            insertBook.bind(1, name)
+                    .bind(2, firstAuthor + authorOutput(rng))
+                    .bind(3, genre)
+                    .bind(4, borrowed[static_cast<std::size_t>(i)] ? 1 : 0)
+                    .step();
+            insertBook.reset();
+            firstBook = i == 0 ? sqlite3_last_insert_rowid(db) : firstBook;
+            counted();
+        }
+
+        for (long long i = 0; i < spec.borrowers; ++i) {
+            name = "Reader " + std::to_string(i + 1);
+            email = "reader" + std::to_string(i + 1) + "@example.com";
+            insertBorrower.bind(1, name).bind(2, email).step();
+            insertBorrower.reset();
+            firstBorrower = i == 0 ? sqlite3_last_insert_rowid(db) : firstBorrower;
+            counted();
+        }
+
+        // Returned history: popular books are borrowed far more often than the long tail
+        for (long long i = 0; spec.books && i < spec.loans - stats.open_loans; ++i) {
+            int borrowDate = current_date - 1 - static_cast<int>(below(std::max(spec.history_days, 1)));
+            int returnDate = borrowDate + 1 + static_cast<int>(below(spec.loan_days * 2));
+            insertLoan.bind(1, firstBook + bookPopularity(rng))
+                    .bind(2, firstBorrower + below(spec.borrowers))
+                    .bind(3, borrowDate)
+                    .bind(4, std::min(returnDate, current_date))
+                    .bind(5, borrowDate + spec.loan_days)
+                    .step();
+            insertLoan.reset();
+            counted();
+        }
+
+        // Open loans, borrowed within the last two loan periods so roughly half are overdue
+        for (long long i = 0; i < spec.books; ++i) {
+            if (!borrowed[static_cast<std::size_t>(i)]) {
+                continue;
+            }
+            int borrowDate = current_date - static_cast<int>(below(spec.loan_days * 2));
+            insertLoan.bind(1, firstBook + i)
+                    .bind(2, firstBorrower + below(spec.borrowers))
+                    .bind(3, borrowDate)
+                    .bind(4, std::optional<int>{})
+                    .bind(5, borrowDate + spec.loan_days)
+                    .step();
+            insertLoan.reset();
+            counted();
+        }
+        storage.commit();
+    } catch (...) {
+        storage.rollback();
+        throw;
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+#endif //LIBRARYMANAGEMENT_GENERATOR_H
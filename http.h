@@ -0,0 +1,491 @@
+#ifndef LIBRARYMANAGEMENT_HTTP_H
+#define LIBRARYMANAGEMENT_HTTP_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// A small HTTP/1.1 server and client for the loopback service mode. Only what the service needs:
+// Content-Length bodies, keep-alive, no chunked encoding, no TLS.
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+constexpr SocketHandle invalidSocket = INVALID_SOCKET;
+
+inline void closeSocket(SocketHandle socket) {
+    closesocket(socket);
+}
+
+// Winsock has to be started once per process before any socket call
+inline void startSockets() {
+    static const bool started = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    if (!started) {
+        throw std::runtime_error("WSAStartup failed");
+    }
+}
+#else
+using SocketHandle = int;
+constexpr SocketHandle invalidSocket = -1;
+
+inline void closeSocket(SocketHandle socket) {
+    ::close(socket);
+}
+
+inline void startSockets() {
+}
+#endif
+
+// Idle keep-alive connections are dropped after this long, so a silent client cannot hold a worker forever
+inline void setReceiveTimeout(SocketHandle socket, int milliseconds) {
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(milliseconds);
+#else
+    timeval timeout{milliseconds / 1000, (milliseconds % 1000) * 1000};
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof timeout);
+}
+
+// Small request/response pairs: send each at once instead of waiting for Nagle's algorithm
+inline void setNoDelay(SocketHandle socket) {
+    int on = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&on), sizeof on);
+}
+
+inline bool sendAll(SocketHandle socket, std::string_view data) {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL; // a peer that hung up is an error return, not SIGPIPE
+#else
+    constexpr int flags = 0;
+#endif
+    while (!data.empty()) {
+        auto sent = ::send(socket, data.data(), static_cast<int>(data.size()), flags);
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+struct HttpRequest {
+    std::string method;
+    std::string path;                          // without the query string
+    std::map<std::string, std::string> query;  // ?after=10&limit=50; values percent-decoded
+    std::string body;
+    bool keep_alive = true;
+
+    std::string param(const std::string &key, const std::string &fallback = "") const {
+        auto it = query.find(key);
+        return it == query.end() ? fallback : it->second;
+    }
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string body;            // JSON
+    bool keep_alive = true;
+};
+
+inline const char *statusText(int status) {
+    switch (status) {
+        case 200:
+            return "OK";
+        case 201:
+            return "Created";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 409:
+            return "Conflict";
+        case 413:
+            return "Payload Too Large";
+        default:
+            return status >= 500 ? "Internal Server Error" : "Error";
+    }
+}
+
+enum class MessageRead {
+    Complete,
+    Closed,    // the peer closed, timed out or sent something unreadable
+    TooLarge   // the Content-Length is over the limit; the body was not read
+};
+
+// Reads one message (start line, headers and Content-Length body) from `socket` into `buffer`, which carries
+// bytes that arrived past the previous message. Returns the start line and headers; the body is left in `body`.
+inline MessageRead readMessage(SocketHandle socket, std::string &buffer, std::string &head, std::string &body) {
+    constexpr std::size_t maxHead = 16 * 1024, maxBody = 1 << 20;
+    char chunk[8192];
+    auto receive = [&] {
+        auto received = ::recv(socket, chunk, static_cast<int>(sizeof chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, static_cast<std::size_t>(received));
+        return true;
+    };
+
+    std::size_t headEnd;
+    while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        if (buffer.size() > maxHead || !receive()) {
+            return MessageRead::Closed;
+        }
+    }
+    head = buffer.substr(0, headEnd);
+
+    std::size_t length = 0;
+    for (std::size_t line = head.find("\r\n"); line != std::string::npos; line = head.find("\r\n", line + 2)) {
+        auto colon = head.find(':', line + 2);
+        auto end = head.find("\r\n", line + 2);
+        if (colon == std::string::npos || colon > end) {
+            continue;
+        }
+        std::string name = head.substr(line + 2, colon - line - 2);
+        for (auto &ch: name) {
+            ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        }
+        if (name == "content-length") {
+            length = std::strtoull(head.c_str() + colon + 1, nullptr, 10);
+        }
+    }
+    if (length > maxBody) {
+        return MessageRead::TooLarge;
+    }
+    while (buffer.size() < headEnd + 4 + length) {
+        if (!receive()) {
+            return MessageRead::Closed;
+        }
+    }
+    body = buffer.substr(headEnd + 4, length);
+    buffer.erase(0, headEnd + 4 + length);
+    return MessageRead::Complete;
+}
+
+// A query-string value with %XX escapes and '+' turned back into the characters they stand for
+inline std::string percentDecoded(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        unsigned value = 0;
+        if (text[i] == '%' && i + 2 < text.size() &&
+            std::from_chars(text.data() + i + 1, text.data() + i + 3, value, 16).ptr == text.data() + i + 3) {
+            out += static_cast<char>(value);
+            i += 2;
+        } else {
+            out += text[i] == '+' ? ' ' : text[i];
+        }
+    }
+    return out;
+}
+
+// Case-insensitive check for "Header: value" in a message head
+inline bool hasHeader(std::string head, std::string_view header) {
+    for (auto &ch: head) {
+        ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    }
+    return head.find(header) != std::string::npos;
+}
+
+inline bool parseRequest(const std::string &head, std::string body, HttpRequest &request) {
+    auto methodEnd = head.find(' ');
+    auto targetEnd = head.find(' ', methodEnd + 1);
+    if (methodEnd == std::string::npos || targetEnd == std::string::npos) {
+        return false;
+    }
+    request.method = head.substr(0, methodEnd);
+    std::string target = head.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    auto question = target.find('?');
+    request.path = target.substr(0, question);
+    request.query.clear();
+    if (question != std::string::npos) {
+        std::string_view query(target);
+        query.remove_prefix(question + 1);
+        while (!query.empty()) {
+            auto pair = query.substr(0, query.find('&'));
+            auto eq = pair.find('=');
+            request.query[std::string(pair.substr(0, eq))] =
+                eq == std::string_view::npos ? "" : percentDecoded(pair.substr(eq + 1));
+            query.remove_prefix(std::min(query.size(), pair.size() + 1));
+        }
+    }
+    request.body = std::move(body);
+    bool http10 = head.compare(targetEnd + 1, 8, "HTTP/1.0") == 0;
+    request.keep_alive = http10 ? hasHeader(head, "\r\nconnection: keep-alive")
+                                : !hasHeader(head, "\r\nconnection: close");
+    return true;
+}
+
+inline std::string formatResponse(const HttpResponse &response) {
+    std::string out = "HTTP/1.1 " + std::to_string(response.status) + " " + statusText(response.status) + "\r\n";
+    out += "Content-Type: application/json\r\n";
+    out += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+    out += response.keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+    out += response.body;
+    return out;
+}
+
+// Listens on 127.0.0.1 and serves connections with a fixed pool of worker threads. Each worker builds its own
+// handler with `makeHandler` on its own thread, so per-worker state such as a database connection is never
+// shared. A worker serves one connection at a time, request after request while the client keeps it alive.
+class HttpServer {
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest &)>;
+
+    HttpServer(int port, int threads, std::function<Handler()> makeHandler)
+        : requestedPort(port), threadCount(std::max(threads, 1)), makeHandler(std::move(makeHandler)) {
+    }
+
+    ~HttpServer() {
+        stop();
+    }
+
+    HttpServer(const HttpServer &) = delete;
+    HttpServer &operator=(const HttpServer &) = delete;
+
+    // Binds and starts the acceptor and workers; returns once the port is listening.
+    void start() {
+        startSockets();
+        listener = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == invalidSocket) {
+            throw std::runtime_error("cannot create socket");
+        }
+        int on = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&on), sizeof on);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<unsigned short>(requestedPort));
+        socklen_t size = sizeof address;
+        if (::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0 ||
+            ::listen(listener, SOMAXCONN) != 0 ||
+            ::getsockname(listener, reinterpret_cast<sockaddr *>(&address), &size) != 0) {
+            closeSocket(listener);
+            throw std::runtime_error("cannot listen on 127.0.0.1:" + std::to_string(requestedPort));
+        }
+        boundPort = ntohs(address.sin_port);
+        running = true;
+
+        // Handlers are built before accepting, so a worker that cannot open its connection fails start()
+        std::vector<Handler> handlers(static_cast<std::size_t>(threadCount));
+        std::exception_ptr failure;
+        {
+            std::vector<std::thread> builders;
+            for (std::size_t i = 0; i < handlers.size(); ++i) {
+                builders.emplace_back([this, &handlers, &failure, i] {
+                    try {
+                        handlers[i] = makeHandler();
+                    } catch (...) {
+                        std::lock_guard lock(mutex);
+                        failure = std::current_exception();
+                    }
+                });
+            }
+            for (auto &builder: builders) {
+                builder.join();
+            }
+        }
+        if (failure) {
+            running = false;
+            closeSocket(listener);
+            std::rethrow_exception(failure);
+        }
+        for (auto &handler: handlers) {
+            workers.emplace_back([this, handler = std::move(handler)] { work(handler); });
+        }
+        acceptor = std::thread([this] { accept(); });
+    }
+
+    int port() const {
+        return boundPort;
+    }
+
+    // Blocks until stop() is called from another thread
+    void wait() {
+        if (acceptor.joinable()) {
+            acceptor.join();
+        }
+    }
+
+    // Stops accepting, lets the workers finish their current connection and joins them.
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+#ifdef _WIN32
+        closeSocket(listener);
+#else
+        ::shutdown(listener, SHUT_RDWR); // wakes the blocked accept()
+        closeSocket(listener);
+#endif
+        ready.notify_all();
+        if (acceptor.joinable()) {
+            acceptor.join();
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        workers.clear();
+        for (auto socket: pending) {
+            closeSocket(socket);
+        }
+        pending.clear();
+    }
+
+private:
+    void accept() {
+        while (running) {
+            SocketHandle client = ::accept(listener, nullptr, nullptr);
+            if (client == invalidSocket) {
+                // Out of descriptors (EMFILE/ENFILE) or an aborted handshake: the next accept() would likely fail
+                // the same way at once, so give the workers a moment to close connections instead of spinning
+                if (running) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+                continue;
+            }
+            setNoDelay(client);
+            setReceiveTimeout(client, 5000);
+            {
+                std::lock_guard lock(mutex);
+                pending.push_back(client);
+            }
+            ready.notify_one();
+        }
+    }
+
+    void work(const Handler &handler) {
+        while (true) {
+            SocketHandle client;
+            {
+                std::unique_lock lock(mutex);
+                ready.wait(lock, [this] { return !pending.empty() || !running; });
+                if (pending.empty()) {
+                    return;
+                }
+                client = pending.front();
+                pending.pop_front();
+            }
+            serve(client, handler);
+            closeSocket(client);
+        }
+    }
+
+    void serve(SocketHandle client, const Handler &handler) {
+        std::string buffer, head, body;
+        HttpRequest request;
+        while (running) {
+            auto read = readMessage(client, buffer, head, body);
+            if (read == MessageRead::Closed) {
+                return;
+            }
+            HttpResponse response;
+            if (read == MessageRead::TooLarge) {
+                // The unread body is still on the socket, so the connection cannot carry another request
+                response = {413, R"({"error":"request body too large"})", false};
+            } else if (!parseRequest(head, std::move(body), request)) {
+                response = {400, R"({"error":"malformed request"})", false};
+            } else {
+                try {
+                    response = handler(request);
+                } catch (...) {
+                    response = {500, R"({"error":"internal error"})", true};
+                }
+                response.keep_alive = response.keep_alive && request.keep_alive;
+            }
+            if (!sendAll(client, formatResponse(response)) || !response.keep_alive) {
+                return;
+            }
+        }
+    }
+
+    int requestedPort;
+    int threadCount;
+    std::function<Handler()> makeHandler;
+    SocketHandle listener = invalidSocket;
+    int boundPort = 0;
+    std::atomic<bool> running{false};
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<SocketHandle> pending;
+    std::vector<std::thread> workers;
+    std::thread acceptor;
+};
+
+// A blocking keep-alive client for one loopback connection, used by the load test.
+class HttpClient {
+public:
+    explicit HttpClient(int port) {
+        startSockets();
+        socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<unsigned short>(port));
+        if (socket == invalidSocket ||
+            ::connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0) {
+            if (socket != invalidSocket) {
+                closeSocket(socket);
+            }
+            throw std::runtime_error("cannot connect to 127.0.0.1:" + std::to_string(port));
+        }
+        setNoDelay(socket);
+    }
+
+    ~HttpClient() {
+        closeSocket(socket);
+    }
+
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    HttpResponse request(const std::string &method, const std::string &target, const std::string &body = "") {
+        std::string message = method + " " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+        if (!body.empty()) {
+            message += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+        }
+        message += "\r\n" + body;
+        std::string head;
+        HttpResponse response;
+        if (!sendAll(socket, message) || readMessage(socket, buffer, head, response.body) != MessageRead::Complete) {
+            throw std::runtime_error("connection lost during " + method + " " + target);
+        }
+        response.status = std::atoi(head.c_str() + head.find(' ') + 1);
+        return response;
+    }
+
+private:
+    SocketHandle socket = invalidSocket;
+    std::string buffer;
+};
+
+#endif //LIBRARYMANAGEMENT_HTTP_H
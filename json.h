@@ -0,0 +1,190 @@
+#ifndef LIBRARYMANAGEMENT_JSON_H
+#define LIBRARYMANAGEMENT_JSON_H
+
+#include "config.h"
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Just enough JSON for the batch and service modes: flat request objects in, hand-built responses out.
+
+// Reads one flat JSON object, e.g. {"title": "Dune", "author": 2}, into Options flags holding each member's
+// text: strings unescaped, numbers as written, true/false as 1/0; null members are left out. Nested objects
+// and arrays are rejected with std::invalid_argument.
+inline Options parseJsonObject(std::string_view line) {
+    std::size_t pos = 0;
+    auto fail = [&](const std::string &what) -> void {
+        throw std::invalid_argument(what + " at column " + std::to_string(pos + 1));
+    };
+    auto skipSpace = [&] {
+        while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r' || line[pos] == '\n')) {
+            ++pos;
+        }
+    };
+    auto expect = [&](char ch) {
+        skipSpace();
+        if (pos >= line.size() || line[pos] != ch) {
+            fail(std::string("expected '") + ch + "'");
+        }
+        ++pos;
+    };
+    auto appendUtf8 = [](std::string &out, std::uint32_t code) {
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | code >> 6));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | code >> 12));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | code >> 18));
+            out.push_back(static_cast<char>(0x80 | (code >> 12 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code >> 6 & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    };
+    // Exactly four hex digits; no sign, space or shorter run
+    auto hex4 = [&] {
+        if (pos + 4 > line.size()) {
+            fail("truncated \\u escape");
+        }
+        for (std::size_t i = pos; i < pos + 4; ++i) {
+            if (!std::isxdigit(static_cast<unsigned char>(line[i]))) {
+                fail("bad \\u escape");
+            }
+        }
+        std::uint32_t code = 0;
+        std::from_chars(line.data() + pos, line.data() + pos + 4, code, 16);
+        pos += 4;
+        return code;
+    };
+    auto readString = [&] {
+        expect('"');
+        std::string out;
+        while (pos < line.size() && line[pos] != '"') {
+            char ch = line[pos++];
+            if (ch != '\\') {
+                out.push_back(ch);
+                continue;
+            }
+            if (pos >= line.size()) {
+                break;
+            }
+            char escape = line[pos++];
+            if (escape == 'u') {
+                std::uint32_t code = hex4();
+                // A surrogate pair encodes one code point above U+FFFF; half a pair has no UTF-8 form
+                if (code >= 0xDC00 && code < 0xE000) {
+                    fail("lone surrogate in \\u escape");
+                }
+                if (code >= 0xD800 && code < 0xDC00) {
+                    if (line.substr(pos, 2) != "\\u") {
+                        fail("lone surrogate in \\u escape");
+                    }
+                    pos += 2;
+                    std::uint32_t low = hex4();
+                    if (low < 0xDC00 || low >= 0xE000) {
+                        fail("lone surrogate in \\u escape");
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, code);
+            } else {
+                static const std::string_view escapes = "n\nt\tr\rb\bf\f";
+                auto mapped = escapes.find(escape);
+                out.push_back(mapped != std::string_view::npos && mapped % 2 == 0 ? escapes[mapped + 1] : escape);
+            }
+        }
+        expect('"');
+        return out;
+    };
+
+    Options object;
+    expect('{');
+    skipSpace();
+    bool first = true;
+    while (pos < line.size() && line[pos] != '}') {
+        if (!first) {
+            expect(',');
+        }
+        first = false;
+        std::string key = readString();
+        expect(':');
+        skipSpace();
+        std::string value;
+        bool present = true;
+        if (pos < line.size() && line[pos] == '"') {
+            value = readString();
+        } else {
+            auto end = line.find_first_of(",} \t\r\n", pos);
+            std::string_view literal = line.substr(pos, end == std::string_view::npos ? line.size() - pos : end - pos);
+            if (literal == "true" || literal == "false") {
+                value = literal == "true" ? "1" : "0";
+            } else if (literal == "null") {
+                present = false;
+            } else if (!literal.empty() && (literal[0] == '-' || (literal[0] >= '0' && literal[0] <= '9'))) {
+                value = literal;
+            } else {
+                fail("unsupported value for \"" + key + "\"");
+            }
+            pos += literal.size();
+        }
+        if (present) {
+            object.values[optionKey(key)] = value;
+        }
+        skipSpace();
+    }
+    expect('}');
+    skipSpace();
+    if (pos != line.size()) {
+        fail("trailing characters");
+    }
+    return object;
+}
+
+// Appends `text` as a quoted JSON string
+inline void appendJsonString(std::string &out, std::string_view text) {
+    out.push_back('"');
+    for (char ch: text) {
+        switch (ch) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof escaped, "\\u%04x", ch);
+                    out += escaped;
+                } else {
+                    out.push_back(ch);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+inline std::string jsonString(std::string_view text) {
+    std::string out;
+    appendJsonString(out, text);
+    return out;
+}
+
+#endif //LIBRARYMANAGEMENT_JSON_H
@@ -0,0 +1,401 @@
+#ifndef LIBRARYMANAGEMENT_LIBRARY_H
+#define LIBRARYMANAGEMENT_LIBRARY_H
+
+#include "storage.h"
+#include "dates.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Library operations without any prompting: listings write to the given stream and the mutations take their
+// arguments directly. The interactive menus, the command line and the benchmarks all call these.
+
+using namespace sqlite_orm;
+
+void listAuthorsAndBooks(auto &storage, std::ostream &out = std::cout) {
+    // One pass over authors LEFT JOIN books ordered by author, printed with a group break whenever the
+    // author changes, so nothing is held in memory. An author without books gets a single row with book id 0.
+    auto rows = storage.iterate(select(columns(&Author::id,
+                                               &Author::name,
+                                               coalesce<int>(&Book::id, 0),
+                                               coalesce<std::string>(&Book::title, ""),
+                                               coalesce<bool>(&Book::is_borrowed, false)),
+                                       left_join<Book>(on(c(&Book::author_id) == &Author::id)),
+                                       multi_order_by(order_by(&Author::id), order_by(&Book::id))));
+    std::optional<int> current_author;
+    for (auto &&[author_id, author_name, book_id, book_title, is_borrowed]: rows) {
+        if (author_id != current_author) {
+            current_author = author_id;
+            out << "Author ID: " << author_id << ", Author Name: " << author_name << "\n";
+            if (book_id == 0) {
+                out << "\tNo books for this author.\n";
+            }
+        }
+        if (book_id != 0) {
+            out << "\tBook ID: " << book_id << ", Book Title: " << book_title
+                << (is_borrowed ? " (Borrowed)" : " (Available)") << "\n";
+        }
+    }
+}
+
+void listBooks(auto &storage, std::ostream &out = std::cout) {
+    // One query: books LEFT JOIN authors LEFT JOIN genres, only the displayed columns; a missing author comes
+    // back as "Unknown" and a book without a genre as ""
+    auto books = storage.iterate(select(columns(&Book::id,
+                                                &Book::title,
+                                                coalesce<std::string>(&Author::name, "Unknown"),
+                                                coalesce<std::string>(&Genre::name, ""),
+                                                &Book::is_borrowed),
+                                        left_join<Author>(on(c(&Book::author_id) == &Author::id)),
+                                        left_join<Genre>(on(c(&Genre::id) == &Book::genre_id)),
+                                        order_by(&Book::id)));
+    for (auto &&[id, title, author_name, genre, is_borrowed]: books) {
+        out << "ID: " << id
+            << ", Title: " << title
+            << ", Author: " << author_name
+            << ", Genre: " << genre
+            << ", Borrowed: " << (is_borrowed ? "Yes" : "No");
+
+        // if (book.is_borrowed) {
+        //     try {
+        //         // Fetch the latest borrow record for the book
+        //         auto borrow_records = storage.template get_all<BorrowRecord>(
+        //             where(c(&BorrowRecord::book_id) == book.id),
+        //             order_by(&BorrowRecord::borrow_date).desc(),
+        //             limit(1) // Ensure only the latest record is retrieved
+        //         );
+        //
+        //         // Check if any borrow records exist
+        //         if (!borrow_records.empty()) {
+        //             try {
+        //                 const auto &borrow_record = borrow_records.front();
+        //                 // Fetch borrower details
+        //                 auto borrower = storage.template get<Borrower>(borrow_record.borrower_id);
+        //
+        //                 std::cout << "\n  Borrower Name: " << borrower.name
+        //                         << "\n  Borrow Date: " << borrow_record.borrow_date.value_or("Unknown")
+        //                         << "\n  Return Date: " << borrow_record.return_date.value_or("Unknown");
+        //             } catch (const std::system_error &e) {
+        //                 std::cerr << "Warning: " << e.what() << '\n';
+        //             }
+        //         } else {
+        //             std::cerr << "\n  No borrow records found for book ID " << book.id << ".\n";
+        //         }
+        //     } catch (const std::system_error &e) {
+        //         std::cerr << "\n  Warning: Borrow record or borrower details for book ID "
+        //                 << book.id << " not found.\n";
+        //     }
+        // }
+
+
+        out << '\n';
+    }
+}
+
+// The id of the genre called `name`, adding it on first use; nullopt for an empty name (no genre).
+// The caller owns the transaction.
+std::optional<int> genreIdFor(auto &storage, const std::string &name) {
+    if (name.empty()) {
+        return std::nullopt;
+    }
+    auto ids = storage.select(&Genre::id, where(c(&Genre::name) == name));
+    if (!ids.empty()) {
+        return ids.front();
+    }
+    return storage.insert(Genre{-1, name});
+}
+
+// "" for a book without a genre
+std::string genreName(auto &storage, const std::optional<int> &genre_id) {
+    auto genre = genre_id ? storage.template get_optional<Genre>(*genre_id) : std::nullopt;
+    return genre ? genre->name : "";
+}
+
+// The genre's books in id order. The name is resolved once and the books are found through the integer index
+// on books.genre_id. Returns false when there is no such genre.
+bool listBooksByGenre(auto &storage, const std::string &genre, std::ostream &out = std::cout) {
+    auto ids = storage.select(&Genre::id, where(c(&Genre::name) == genre));
+    if (ids.empty()) {
+        return false;
+    }
+    auto books = storage.iterate(select(columns(&Book::id,
+                                                &Book::title,
+                                                coalesce<std::string>(&Author::name, "Unknown"),
+                                                &Book::is_borrowed),
+                                        left_join<Author>(on(c(&Book::author_id) == &Author::id)),
+                                        where(c(&Book::genre_id) == ids.front()),
+                                        order_by(&Book::id)));
+    for (auto &&[id, title, author_name, is_borrowed]: books) {
+        out << "ID: " << id
+            << ", Title: " << title
+            << ", Author: " << author_name
+            << ", Borrowed: " << (is_borrowed ? "Yes" : "No") << '\n';
+    }
+    return true;
+}
+
+// Books per genre by name, grouped on the integer genre_id with a scan of its index alone; only the handful of
+// genre names are read from the genres table. Books without a genre are counted last.
+void listGenreCounts(auto &storage, std::ostream &out = std::cout) {
+    std::map<std::optional<int>, int> counts;
+    for (auto &&[genre_id, books]: storage.select(columns(&Book::genre_id, count<Book>()),
+                                                  group_by(&Book::genre_id))) {
+        counts[genre_id] = books;
+    }
+    std::vector<std::pair<std::string, int>> genres;
+    for (const auto &genre: storage.template get_all<Genre>()) {
+        genres.emplace_back(genre.name, counts[genre.id]);
+    }
+    std::sort(genres.begin(), genres.end());
+    for (const auto &[name, books]: genres) {
+        out << "Genre: " << name << ", Books: " << books << '\n';
+    }
+    if (counts[std::nullopt]) {
+        out << "Genre: (none), Books: " << counts[std::nullopt] << '\n';
+    }
+}
+
+void listAuthors(auto &storage, std::ostream &out = std::cout) {
+    auto authors = storage.template get_all<Author>();
+    for (const auto &author: authors) {
+        out << "ID: " << author.id << ", Name: " << author.name << '\n';
+    }
+}
+
+void listBorrowers(auto &storage, std::ostream &out = std::cout) {
+    // borrowers LEFT JOIN borrow_records LEFT JOIN books in one streamed pass, grouped per borrower.
+    // Borrowers without loans have record id 0; loans whose book was deleted have book id 0.
+    auto rows = storage.iterate(select(columns(&Borrower::id,
+                                               &Borrower::name,
+                                               &Borrower::email,
+                                               coalesce<int>(&BorrowRecord::id, 0),
+                                               coalesce<int>(&BorrowRecord::book_id, 0),
+                                               coalesce<int>(&Book::id, 0),
+                                               coalesce<std::string>(&Book::title, "")),
+                                       left_join<BorrowRecord>(on(c(&BorrowRecord::borrower_id) == &Borrower::id)),
+                                       left_join<Book>(on(c(&Book::id) == &BorrowRecord::book_id)),
+                                       multi_order_by(order_by(&Borrower::id), order_by(&BorrowRecord::id))));
+    std::optional<int> current_borrower;
+    for (auto &&[borrower_id, name, email, record_id, record_book_id, book_id, title]: rows) {
+        if (borrower_id != current_borrower) {
+            current_borrower = borrower_id;
+            // Display borrower details
+            out << "ID: " << borrower_id
+                << ", Name: " << name
+                << ", Email: " << email << '\n';
+            if (record_id == 0) {
+                out << "  No books borrowed.\n";
+            }
+        }
+        if (record_id == 0) {
+            continue;
+        }
+        if (book_id == 0) {
+            out << "  Book Borrowed: [deleted book ID " << record_book_id << "]\n";
+        } else {
+            out << "  Book Borrowed: " << title << '\n';
+        }
+    }
+}
+
+enum class CheckoutResult {
+    Ok,
+    BookNotFound,
+    AlreadyBorrowed
+};
+
+// Claims the book with a conditional UPDATE and records the loan only if exactly one row changed,
+// so two clients can never check out the same copy. The caller owns the transaction.
+CheckoutResult checkoutBook(auto &storage, int book_id, int borrower_id, int borrow_date, int due_date) {
+    storage.update_all(set(c(&Book::is_borrowed) = true),
+                       where(c(&Book::id) == book_id and c(&Book::is_borrowed) == false));
+    if (storage.changes() != 1) {
+        return storage.template count<Book>(where(c(&Book::id) == book_id)) ? CheckoutResult::AlreadyBorrowed
+                                                                            : CheckoutResult::BookNotFound;
+    }
+    storage.insert(BorrowRecord{-1, book_id, borrower_id, borrow_date, {}, due_date});
+    return CheckoutResult::Ok;
+}
+
+// Marks an open loan as returned and frees its book. Returns false when the loan was already closed.
+// The caller owns the transaction.
+bool closeLoan(auto &storage, int record_id, int book_id, int return_date) {
+    storage.update_all(set(c(&BorrowRecord::return_date) = return_date),
+                       where(c(&BorrowRecord::id) == record_id and is_null(&BorrowRecord::return_date)));
+    if (storage.changes() != 1) {
+        return false;
+    }
+    storage.update_all(set(c(&Book::is_borrowed) = false), where(c(&Book::id) == book_id));
+    return true;
+}
+
+void listOpenLoans(auto &storage, std::ostream &out = std::cout) {
+    // Open loans only (return_date IS NULL, served by the partial index) with book and borrower joined in
+    auto loans = storage.iterate(select(columns(&BorrowRecord::id,
+                                                coalesce<std::string>(&Book::title, "Unknown"),
+                                                coalesce<std::string>(&Borrower::name, "Unknown"),
+                                                &BorrowRecord::borrow_date),
+                                        left_join<Book>(on(c(&Book::id) == &BorrowRecord::book_id)),
+                                        left_join<Borrower>(on(c(&Borrower::id) == &BorrowRecord::borrower_id)),
+                                        where(is_null(&BorrowRecord::return_date)),
+                                        order_by(&BorrowRecord::id)));
+    bool any = false;
+    for (auto &&[id, title, borrower_name, borrow_date]: loans) {
+        if (!any) {
+            out << "Borrow Records:\n";
+            any = true;
+        }
+        out << "Borrow ID: " << id
+            << " | Book: " << title
+            << " | Borrower: " << borrower_name
+            << " | Borrow Date: " << formatDate(borrow_date, "Unknown") << "\n";
+    }
+    if (!any) {
+        out << "No books are currently borrowed.\n";
+    }
+}
+
+// True when any of the author's books is out on loan, which blocks deleting the author
+bool authorHasBorrowedBooks(auto &storage, int author_id) {
+    return storage.template count<Book>(
+        where(c(&Book::author_id) == author_id and c(&Book::is_borrowed) == true)) > 0;
+}
+
+// Rows removed by a cascading delete
+struct DeleteCounts {
+    int borrow_records = 0;
+    int books = 0;
+    int authors = 0;
+};
+
+// Deleting the author cascades to their books and the books' loans inside SQLite (ON DELETE CASCADE).
+// The dependent rows are counted first because sqlite3_changes() leaves cascaded rows out.
+// The caller owns the transaction.
+DeleteCounts deleteAuthor(auto &storage, int author_id) {
+    DeleteCounts counts;
+    counts.borrow_records = storage.template count<BorrowRecord>(
+        where(in(&BorrowRecord::book_id, select(&Book::id, where(c(&Book::author_id) == author_id)))));
+    counts.books = storage.template count<Book>(where(c(&Book::author_id) == author_id));
+    storage.template remove_all<Author>(where(c(&Author::id) == author_id));
+    counts.authors = storage.changes();
+    return counts;
+}
+
+// The book's loans go with it through ON DELETE CASCADE. The caller owns the transaction.
+DeleteCounts deleteBook(auto &storage, int book_id) {
+    DeleteCounts counts;
+    counts.borrow_records = storage.template count<BorrowRecord>(where(c(&BorrowRecord::book_id) == book_id));
+    storage.template remove_all<Book>(where(c(&Book::id) == book_id));
+    counts.books = storage.changes();
+    return counts;
+}
+
+// Optional narrowing of the borrow history; 0 / nullopt means "any". Each filter is backed by an index.
+struct RecordFilter {
+    int borrower_id = 0;
+    int book_id = 0;
+    std::optional<int> borrowed_from; // inclusive, epoch days
+    std::optional<int> borrowed_to;   // inclusive, epoch days
+};
+
+// Streams borrow_records LEFT JOIN books LEFT JOIN borrowers row by row into a fixed-size output buffer,
+// so memory stays constant no matter how long the history is.
+void streamBorrowRecords(auto &storage, const RecordFilter &filter, std::ostream &out) {
+    std::string buffer;
+    buffer.reserve(1 << 16);
+
+    // Runs the query with the active filters ANDed together
+    auto stream = [&](auto... predicates) {
+        auto run = [&](auto... conditions) {
+            auto rows = storage.iterate(select(columns(&BorrowRecord::id,
+                                                       coalesce<std::string>(&Book::title, "Unknown"),
+                                                       coalesce<std::string>(&Borrower::name, "Unknown"),
+                                                       &BorrowRecord::borrow_date,
+                                                       &BorrowRecord::return_date),
+                                               left_join<Book>(on(c(&Book::id) == &BorrowRecord::book_id)),
+                                               left_join<Borrower>(on(c(&Borrower::id) == &BorrowRecord::borrower_id)),
+                                               conditions...,
+                                               order_by(&BorrowRecord::id)));
+            for (auto &&[id, title, borrower_name, borrow_date, return_date]: rows) {
+                buffer += "Borrow ID: " + std::to_string(id) + " || Book: " + title + " || Borrower Name: " +
+                        borrower_name + " || Borrowed Date: " + formatDate(borrow_date, "Unknown") +
+                        " || Return Date: " + formatDate(return_date, "N/A") + "\n";
+                if (buffer.size() > (1 << 16) - 512) {
+                    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    buffer.clear();
+                }
+            }
+        };
+        if constexpr (sizeof...(predicates) == 0) {
+            run();
+        } else {
+            run(where((predicates and ...)));
+        }
+    };
+
+    // Each filter that is set adds its predicate before handing on to the next one
+    auto byDate = [&](auto... predicates) {
+        if (filter.borrowed_from || filter.borrowed_to) {
+            stream(predicates...,
+                   c(&BorrowRecord::borrow_date) >= filter.borrowed_from.value_or(std::numeric_limits<int>::min()),
+                   c(&BorrowRecord::borrow_date) <= filter.borrowed_to.value_or(std::numeric_limits<int>::max()));
+        } else {
+            stream(predicates...);
+        }
+    };
+    auto byBook = [&](auto... predicates) {
+        if (filter.book_id) {
+            byDate(predicates..., c(&BorrowRecord::book_id) == filter.book_id);
+        } else {
+            byDate(predicates...);
+        }
+    };
+    if (filter.borrower_id) {
+        byBook(c(&BorrowRecord::borrower_id) == filter.borrower_id);
+    } else {
+        byBook();
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.flush();
+}
+
+// Closes the open loan of `book_id`, found through the open-loan index. Returns false when the book is not
+// out on loan. The caller owns the transaction.
+bool returnByBookId(auto &storage, auto &repo, int book_id, int return_date) {
+    auto record = repo.openLoanOfBook(book_id);
+    return record && closeLoan(storage, record->id, book_id, return_date);
+}
+
+// Open loans past their due date, most overdue first. The query walks the partial index on due_date
+// (return_date IS NULL) and stops at `current_date`, so the cost follows the number of overdue loans, not the
+// history. Returns the number of loans written.
+int writeOverdueLoans(auto &storage, int current_date, std::ostream &out = std::cout) {
+    auto loans = storage.iterate(select(columns(&BorrowRecord::id,
+                                                coalesce<std::string>(&Book::title, "Unknown"),
+                                                coalesce<std::string>(&Borrower::name, "Unknown"),
+                                                coalesce<std::string>(&Borrower::email, ""),
+                                                &BorrowRecord::due_date),
+                                        left_join<Book>(on(c(&Book::id) == &BorrowRecord::book_id)),
+                                        left_join<Borrower>(on(c(&Borrower::id) == &BorrowRecord::borrower_id)),
+                                        where(is_null(&BorrowRecord::return_date) and
+                                              c(&BorrowRecord::due_date) < current_date),
+                                        order_by(&BorrowRecord::due_date)));
+    int count = 0;
+    for (auto &&[id, title, borrower_name, email, due_date]: loans) {
+        out << "Borrow ID: " << id
+            << " | Book: " << title
+            << " | Borrower: " << borrower_name << " <" << email << ">"
+            << " | Due: " << formatDate(due_date, "Unknown")
+            << " | Days overdue: " << current_date - due_date.value_or(current_date) << "\n";
+        ++count;
+    }
+    return count;
+}
+
+#endif //LIBRARYMANAGEMENT_LIBRARY_H
@@ -1,4 +1,15 @@
-#include "sqlite_orm/sqlite_orm.h"
+#include "storage.h"
+#include "library.h"
+#include "repository.h"
+#include "migrations.h"
+#include "dates.h"
+#include "bulk_import.h"
+#include "csv_export.h"
+#include "generator.h"
+#include "commands.h"
+#include "batch.h"
+#include "service.h"
+#include "catalog_cache.h"
 #include <iostream>
 #include <string>
 #include <optional>
@@ -7,143 +18,104 @@
 #include <sstream>
 #include <ctime>
 #include <regex>
+#include <limits>
+#include <algorithm>
 
 using namespace sqlite_orm;
 
-// Entities
-struct Book {
-    int id;
-    std::string title;
-    int author_id;
-    std::string genre;
-    bool is_borrowed;
-};
-
-struct Author {
-    int id;
-    std::string name;
-};
-
-struct Borrower {
-    int id;
-    std::string name;
-    std::string email;
-};
-
-struct BorrowRecord {
-    int id;
-    int book_id;
-    int borrower_id;
-    std::optional<std::string> borrow_date;
-    std::optional<std::string> return_date;
-};
-
 // prototypes
-auto createStorage();
-void createTestData(auto &storage);
-void addBook(auto &storage);
-void updateBook(auto &storage);
-void listBooks(auto &storage);
+void addBook(auto &storage, CatalogCache<Storage> *catalog);
+void updateBook(auto &storage, CatalogCache<Storage> *catalog);
 void addAuthor(auto &storage);
-void listAuthorsAndBooks(auto &storage);
-void listAuthors(auto &storage);
 void registerBorrower(auto &storage);
-void listBorrowers(auto &storage);
-void borrowBook(auto &storage);
-void returnBook(auto &storage);
-void removeBook(auto &storage);
+void borrowBook(auto &storage, auto &repo, const LoanPolicy &policy);
+void returnBook(auto &storage, auto &repo);
+void removeBook(auto &storage, CatalogCache<Storage> *catalog);
 void mainMenu();
 
-// Storage setup
-auto createStorage() {
-    using namespace sqlite_orm;
-
-    return make_storage("library.sqlite",
-                        make_table("books",
-                                   make_column("id", &Book::id, primary_key().autoincrement()),
-                                   make_column("title", &Book::title),
-                                   make_column("author_id", &Book::author_id),
-                                   make_column("genre", &Book::genre),
-                                   make_column("is_borrowed", &Book::is_borrowed)),
-                        make_table("authors",
-                                   make_column("id", &Author::id, primary_key().autoincrement()),
-                                   make_column("name", &Author::name)),
-                        make_table("borrowers",
-                                   make_column("id", &Borrower::id, primary_key().autoincrement()),
-                                   make_column("name", &Borrower::name),
-                                   make_column("email", &Borrower::email)),
-                        make_table("borrow_records",
-                                   make_column("id", &BorrowRecord::id, primary_key().autoincrement()),
-                                   make_column("book_id", &BorrowRecord::book_id),
-                                   make_column("borrower_id", &BorrowRecord::borrower_id),
-                                   make_column("borrow_date", &BorrowRecord::borrow_date),
-                                   make_column("return_date", &BorrowRecord::return_date)));
+// Reads a whole number typed at a prompt. A non-number leaves std::cin in a failed state in which every later
+// read returns at once, so the state is cleared and the rest of the line dropped before reporting failure.
+bool readInt(int &value) {
+    if (std::cin >> value) {
+        return true;
+    }
+    if (!std::cin.eof()) {
+        std::cin.clear();
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    return false;
 }
 
-void createTestData(auto &storage) {
-    // Add authors
-    storage.replace(Author{-1, "J.K. Rowling"});
-    storage.replace(Author{-1, "George Orwell"});
-    storage.replace(Author{-1, "J.R.R. Tolkien"});
-
-    // Add books
-    storage.replace(Book{-1, "Harry Potter", 1, "Fantasy", false});
-    storage.replace(Book{-1, "1984", 2, "Dystopian", false});
-    storage.replace(Book{-1, "The Hobbit", 3, "Fantasy", false});
-
-    // Add borrowers
-    storage.replace(Borrower{-1, "Alice Smith", "alice@example.com"});
-    storage.replace(Borrower{-1, "Bob Johnson", "bob@example.com"});
+// A menu choice; -1 for anything that is not a number, and 0 (back / exit) once input has ended, so the
+// menus unwind instead of spinning on a closed stdin.
+int readChoice() {
+    int choice;
+    if (readInt(choice)) {
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        return choice;
+    }
+    return std::cin.eof() ? 0 : -1;
+}
 
-    // Add borrow records
-    storage.replace(BorrowRecord{-1, 1, 1, "2024-11-01", "2024-11-10"});
-    storage.replace(BorrowRecord{-1, 2, 2, "2024-11-05", "2024-11-15"});
+// The listings the menus print, from the catalog cache when the session has one
+void listBooksFrom(auto &storage, CatalogCache<Storage> *catalog) {
+    if (catalog) {
+        listBooks(*catalog);
+    } else {
+        listBooks(storage);
+    }
 }
 
-void listAuthorsAndBooks(auto &storage) {
-    auto authors = storage.template get_all<Author>();
-    for (const auto& author : authors) {
-        std::cout << "Author ID: " << author.id << ", Author Name: " << author.name << "\n";
-        auto books = storage.template get_all<Book>(where(c(&Book::author_id) == author.id));
-        if (books.empty()) {
-            std::cout << "\tNo books for this author.\n";
-        } else {
-            for (const auto& book : books) {
-                std::cout << "\tBook ID: " << book.id << ", Book Title: " << book.title
-                          << (book.is_borrowed ? " (Borrowed)" : " (Available)") << "\n";
-            }
-        }
+void listAuthorsFrom(auto &storage, CatalogCache<Storage> *catalog) {
+    if (catalog) {
+        listAuthors(*catalog);
+    } else {
+        listAuthors(storage);
     }
 }
 
-void addBook(auto &storage) {
-    std::string title, genre;
-    int author_id;
+void addBook(auto &storage, CatalogCache<Storage> *catalog) {
+    try {
+        std::string title, genre;
+        int author_id;
 
-    std::cout << "Enter book title: ";
-    std::getline(std::cin, title);
-    // list authors
-    listAuthors(storage);
-    std::cout << "Enter author ID: ";
-    std::cin >> author_id;
+        std::cout << "Enter book title: ";
+        std::getline(std::cin, title);
+        // list authors
+        listAuthorsFrom(storage, catalog);
+        std::cout << "Enter author ID: ";
+        if (!readInt(author_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
 
-    std::cin.ignore(); // Clear input buffer
-    std::cout << "Enter genre: ";
-    std::getline(std::cin, genre);
+        std::cin.ignore(); // Clear input buffer
+        std::cout << "Enter genre: ";
+        std::getline(std::cin, genre);
 
-    storage.insert(Book{-1, title, author_id, genre, false});
-    std::cout << "Book added successfully.\n";
+        // The foreign key on books.author_id rejects an unknown author; a new genre name is added with the book
+        storage.transaction([&] {
+            storage.insert(Book{-1, title, author_id, genreIdFor(storage, genre), false});
+            return true;
+        });
+        std::cout << "Book added successfully.\n";
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+    }
 }
 
-void updateBook(auto &storage) {
+void updateBook(auto &storage, CatalogCache<Storage> *catalog) {
     try {
         int book_id;
         std::cout << "Enter book ID: ";
-        std::cin >> book_id;
+        if (!readInt(book_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
         std::cin.ignore(); // Clear the input buffer
 
         // Find the book by ID
-        auto book = storage.template get_optional<Book>(book_id);
+        auto book = catalog ? catalog->book(book_id) : storage.template get_optional<Book>(book_id);
         if (!book) {
             std::cout << "Book with ID " << book_id << " not found.\n";
             return;
@@ -153,7 +125,8 @@ void updateBook(auto &storage) {
         std::cout << "Book Found > ID: " << book->id
                 << ", Title: " << book->title
                 << ", Author ID: " << book->author_id
-                << ", Genre: " << book->genre << "\n";
+                << ", Genre: " << (catalog ? catalog->genreName(book->genre_id) : genreName(storage, book->genre_id))
+                << "\n";
 
         // Get updated details from the user
         std::string new_title, new_genre;
@@ -166,7 +139,10 @@ void updateBook(auto &storage) {
         }
 
         std::cout << "Enter new author ID (or -1 to keep current): ";
-        std::cin >> new_author_id;
+        if (!readInt(new_author_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
         std::cin.ignore(); // Clear the input buffer
         if (new_author_id != -1) {
             book->author_id = new_author_id;
@@ -174,12 +150,14 @@ void updateBook(auto &storage) {
 
         std::cout << "Enter new genre (leave blank to keep current): ";
         std::getline(std::cin, new_genre);
-        if (!new_genre.empty()) {
-            book->genre = new_genre;
-        }
-
-        // Update the book in the database
-        storage.update(*book);
+        // Update the book in the database, adding the genre if it is new
+        storage.transaction([&] {
+            if (!new_genre.empty()) {
+                book->genre_id = genreIdFor(storage, new_genre);
+            }
+            storage.update(*book);
+            return true;
+        });
 
         std::cout << "Book updated successfully!\n";
     } catch (const std::exception &e) {
@@ -187,58 +165,6 @@ void updateBook(auto &storage) {
     }
 }
 
-void listBooks(auto &storage) {
-    auto books = storage.template get_all<Book>();
-    for (const auto &book: books) {
-        std::optional<Author> author;
-        try {
-            author = storage.template get<Author>(book.author_id);
-        } catch (const std::system_error &e) {
-            std::cerr << "Warning: Author with ID " << book.author_id << " not found.\n";
-        }
-
-        std::cout << "ID: " << book.id
-                << ", Title: " << book.title
-                << ", Author: " << (author ? author->name : "Unknown")
-                << ", Genre: " << book.genre
-                << ", Borrowed: " << (book.is_borrowed ? "Yes" : "No");
-
-        // if (book.is_borrowed) {
-        //     try {
-        //         // Fetch the latest borrow record for the book
-        //         auto borrow_records = storage.template get_all<BorrowRecord>(
-        //             where(c(&BorrowRecord::book_id) == book.id),
-        //             order_by(&BorrowRecord::borrow_date).desc(),
-        //             limit(1) // Ensure only the latest record is retrieved
-        //         );
-        //
-        //         // Check if any borrow records exist
-        //         if (!borrow_records.empty()) {
-        //             try {
-        //                 const auto &borrow_record = borrow_records.front();
-        //                 // Fetch borrower details
-        //                 auto borrower = storage.template get<Borrower>(borrow_record.borrower_id);
-        //
-        //                 std::cout << "\n  Borrower Name: " << borrower.name
-        //                         << "\n  Borrow Date: " << borrow_record.borrow_date.value_or("Unknown")
-        //                         << "\n  Return Date: " << borrow_record.return_date.value_or("Unknown");
-        //             } catch (const std::system_error &e) {
-        //                 std::cerr << "Warning: " << e.what() << '\n';
-        //             }
-        //         } else {
-        //             std::cerr << "\n  No borrow records found for book ID " << book.id << ".\n";
-        //         }
-        //     } catch (const std::system_error &e) {
-        //         std::cerr << "\n  Warning: Borrow record or borrower details for book ID "
-        //                 << book.id << " not found.\n";
-        //     }
-        // }
-
-
-        std::cout << '\n';
-    }
-}
-
 void addAuthor(auto &storage) {
     std::string name;
     std::cout << "Enter author name: ";
@@ -247,13 +173,6 @@ void addAuthor(auto &storage) {
     std::cout << "Author added successfully.\n";
 }
 
-void listAuthors(auto &storage) {
-    auto authors = storage.template get_all<Author>();
-    for (const auto &author: authors) {
-        std::cout << "ID: " << author.id << ", Name: " << author.name << '\n';
-    }
-}
-
 void registerBorrower(auto &storage) {
     std::string name, email;
     std::cout << "Enter borrower name: ";
@@ -265,71 +184,40 @@ void registerBorrower(auto &storage) {
     std::cout << "Borrower registered successfully.\n";
 }
 
-void listBorrowers(auto &storage) {
-    auto borrowers = storage.template get_all<Borrower>();
-    for (const Borrower &borrower: borrowers) {
-        // Display borrower details
-        std::cout << "ID: " << borrower.id
-                << ", Name: " << borrower.name
-                << ", Email: " << borrower.email << '\n';
-
-        try {
-            // Retrieve borrow records for this borrower
-            auto borrowed_books = storage.template get_all<BorrowRecord>(
-                sqlite_orm::where(sqlite_orm::c(&BorrowRecord::borrower_id) == borrower.id)
-            );
-
-            // Display books borrowed by the borrower
-            if (borrowed_books.empty()) {
-                std::cout << "  No books borrowed.\n";
-            } else {
-                try {
-                    for (const BorrowRecord &borrowRecord: borrowed_books) {
-                        auto book = storage.template get<Book>(borrowRecord.book_id);
-                        std::cout << "  Book Borrowed: " << book.title << '\n';
-                    }
-                } catch (std::exception &e) {
-                    std::cerr << "Borrowed book has been deleted/not found: " << e.what() << '\n';
-                }
-            }
-        } catch (std::exception &e) {
-            std::cerr << "Warning: " << e.what() << '\n';
-        }
-    }
-}
-
-void borrowBook(auto &storage) {
+void borrowBook(auto &storage, auto &repo, const LoanPolicy &policy) {
     try {
         int book_id, borrower_id;
         std::cout << "Enter book ID: ";
-        std::cin >> book_id;
+        if (!readInt(book_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
 
-        auto book = storage.template get<Book>(book_id);
-        if (book.is_borrowed) {
+        auto book = repo.book(book_id);
+        if (!book) {
+            std::cout << "Book with ID " << book_id << " not found.\n";
+            return;
+        }
+        if (book->is_borrowed) {
             std::cout << "Book is already borrowed.\n";
             return;
         }
 
         std::cout << "Enter borrower ID: ";
-        std::cin >> borrower_id;
-
-        // Get current date
-        auto now = std::chrono::system_clock::now();
-        auto time_t_now = std::chrono::system_clock::to_time_t(now);
-        std::tm local_time;
-#ifdef _WIN32
-        localtime_s(&local_time, &time_t_now);
-#else
-    localtime_r(&time_t_now, &local_time);
-#endif
-
-        // Format current date as DD-MM-YYYY
-        std::ostringstream current_date_stream;
-        current_date_stream << std::put_time(&local_time, "%d-%m-%Y");
-        std::string current_date = current_date_stream.str();
+        if (!readInt(borrower_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
+
+        if (!repo.borrower(borrower_id)) {
+            std::cout << "Borrower with ID " << borrower_id << " not found.\n";
+            return;
+        }
+
+        int current_date = today();
 
         // Display the current date to the user
-        // std::cout << "Today's date: " << current_date << "\n";
+        // std::cout << "Today's date: " << formatDate(current_date) << "\n";
 
         // Prompt the user for the return date
         // std::cout << "Enter return date (dd-mm-yyyy): ";
@@ -343,111 +231,79 @@ void borrowBook(auto &storage) {
             // return;
         // }
 
-        // Insert borrow record into the database
-        storage.insert(BorrowRecord{-1, book_id, borrower_id, current_date, {}});
-
-        // Mark the book as borrowed and update the database
-        book.is_borrowed = true;
-        storage.update(book);
-
-        std::cout << "Book borrowed successfully.\n";
+        // Claim the book and record the loan in one commit; another desk may have taken it since the check above
+        CheckoutResult result = CheckoutResult::BookNotFound;
+        storage.transaction([&] {
+            result = checkoutBook(storage, book_id, borrower_id, current_date, current_date + policy.loan_days);
+            return result == CheckoutResult::Ok;
+        });
+
+        switch (result) {
+            case CheckoutResult::Ok:
+                std::cout << "Book borrowed successfully. Due back on "
+                          << formatDate(current_date + policy.loan_days) << ".\n";
+                break;
+            case CheckoutResult::AlreadyBorrowed:
+                std::cout << "Book is already borrowed.\n";
+                break;
+            case CheckoutResult::BookNotFound:
+                std::cout << "Book with ID " << book_id << " not found.\n";
+                break;
+        }
     } catch (const std::exception &e) {
         std::cerr << "Custom Error: " << e.what() << '\n';
     }
 }
 
-void returnBook(auto &storage) {
+void returnBook(auto &storage, auto &repo) {
     try {
-        // Fetch all books that are currently borrowed
-        auto borrowed_books = storage.template get_all<Book>(
-            where(c(&Book::is_borrowed) == true)
-        );
-
-        if (borrowed_books.empty()) {
-            std::cout << "No books are currently borrowed.\n";
+        // Fast path: the clerk scans or types the book ID and its open loan is found through the index
+        int book_id;
+        std::cout << "Enter book ID to return (0 to list open loans): ";
+        if (!readInt(book_id)) {
+            std::cout << "Please enter a number.\n";
             return;
         }
 
-        std::vector<std::pair<BorrowRecord, Book>> records_to_return;
-
-        // Collect all records of borrowed books
-        for (const Book &book : borrowed_books) {
-            try {
-                auto borrow_records = storage.template get_all<BorrowRecord>(
-                    where(c(&BorrowRecord::book_id) == book.id)
-                );
-
-                for (const auto &record : borrow_records) {
-                    if (!record.return_date.has_value()) { // Check for NULL return_date manually
-                        records_to_return.emplace_back(record, book);
-                    }
-                }
-            } catch (const std::system_error &e) {
-                std::cerr << "Warning: No borrow record found for book ID " << book.id << ".\n";
+        std::optional<BorrowRecord> record;
+        if (book_id != 0) {
+            record = repo.openLoanOfBook(book_id);
+            if (!record) {
+                std::cerr << "Error: Book ID " << book_id << " is not currently borrowed.\n";
+                return;
             }
-        }
-
-        if (records_to_return.empty()) {
-            std::cout << "No unreturned borrow records found.\n";
-            return;
-        }
+        } else {
+            listOpenLoans(storage);
 
-        // Display the list of unreturned borrow records
-        std::cout << "Borrow Records:\n";
-        for (const auto &[record, book] : records_to_return) {
-            try {
-                auto borrower = storage.template get<Borrower>(record.borrower_id);
+            // Prompt the user to select a borrow record to return
+            int borrow_id;
+            std::cout << "\nEnter the Borrow ID to mark as returned: ";
+            if (!readInt(borrow_id)) {
+                std::cout << "Please enter a number.\n";
+                return;
+            }
 
-                std::cout << "Borrow ID: " << record.id
-                          << " | Book: " << book.title
-                          << " | Borrower: " << borrower.name
-                          << " | Borrow Date: " << record.borrow_date.value_or("Unknown") << "\n";
-            } catch (const std::system_error &e) {
-                std::cerr << "Warning: Borrower details not found for record ID " << record.id << ".\n";
+            record = repo.borrowRecord(borrow_id);
+            if (!record || record->return_date) {
+                std::cerr << "Error: Invalid Borrow ID entered.\n";
+                return;
             }
         }
 
-        // Prompt the user to select a borrow record to return
-        int borrow_id;
-        std::cout << "\nEnter the Borrow ID to mark as returned: ";
-        std::cin >> borrow_id;
-
-        // Find the selected borrow record
-        auto it = std::find_if(records_to_return.begin(), records_to_return.end(),
-                               [borrow_id](const std::pair<BorrowRecord, Book> &entry) {
-                                   return entry.first.id == borrow_id;
-                               });
-
-        if (it == records_to_return.end()) {
-            std::cerr << "Error: Invalid Borrow ID entered.\n";
+        int current_date = today();
+        bool returned = false;
+        storage.transaction([&] {
+            returned = closeLoan(storage, record->id, record->book_id, current_date);
+            return returned;
+        });
+        if (!returned) {
+            std::cerr << "Error: Borrow ID " << record->id << " was already returned.\n";
             return;
         }
 
-        BorrowRecord record = it->first;
-        Book book = it->second;
-
-        // Get the current date in DD-MM-YYYY format
-        auto now = std::chrono::system_clock::now();
-        auto time_t_now = std::chrono::system_clock::to_time_t(now);
-        std::tm local_time;
-#ifdef _WIN32
-        localtime_s(&local_time, &time_t_now);
-#else
-        localtime_r(&time_t_now, &local_time);
-#endif
-        std::ostringstream current_date_stream;
-        current_date_stream << std::put_time(&local_time, "%d-%m-%Y");
-        std::string current_date = current_date_stream.str();
-
-        // Update the borrow record with the return date
-        record.return_date = current_date;
-        storage.update(record);
-
-        // Mark the book as available
-        book.is_borrowed = false;
-        storage.update(book);
-
-        std::cout << "Book '" << book.title << "' has been successfully returned on " << current_date << ".\n";
+        auto book = repo.book(record->book_id);
+        std::cout << "Book '" << (book ? book->title : "Unknown") << "' has been successfully returned on "
+                  << formatDate(current_date) << ".\n";
 
     } catch (const std::exception &e) {
         std::cerr << "Custom Error: " << e.what() << '\n';
@@ -461,41 +317,32 @@ void removeAuthor(auto &storage) {
 
         std::cout << "Enter Author ID to delete: ";
         int author_id;
-        std::cin >> author_id;
+        if (!readInt(author_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
 
-        // First, check if there are any borrowed books by this author
-        auto books = storage.template get_all<Book>(where(c(&Book::author_id) == author_id));
         bool hasBorrowedBooks = false;
-
-        // Check if any of the books are borrowed
-        for (const auto& book : books) {
-            if (book.is_borrowed) {
-                hasBorrowedBooks = true;
-                break;
+        DeleteCounts counts;
+        storage.transaction([&] {
+            // Check, inside the transaction, that none of the author's books is out on loan
+            hasBorrowedBooks = authorHasBorrowedBooks(storage, author_id);
+            if (hasBorrowedBooks) {
+                return false;
             }
-        }
+            counts = deleteAuthor(storage, author_id);
+            return true;
+        });
 
         if (hasBorrowedBooks) {
             std::cout << "Cannot delete the author because some of their books are borrowed.\n";
             return;
         }
-
-        // Delete borrow records for books by this author
-        for (const auto& book : books) {
-            // Get borrow records related to this book
-            auto borrow_records = storage.template get_all<BorrowRecord>(where(c(&BorrowRecord::book_id) == book.id));
-            // Delete each borrow record
-            for (const auto& record : borrow_records) {
-                storage.template remove<BorrowRecord>(record.id);
-                std::cout << "Removed BorrowRecord ID: " << record.id << "\n";
-            }
-            // Remove the book itself
-            storage.template remove<Book>(book.id);
-            std::cout << "Removed Book ID: " << book.id << "\n";
+        if (counts.authors == 0) {
+            std::cout << "Author with ID " << author_id << " not found.\n";
+            return;
         }
-
-        // Finally, remove the author
-        storage.template remove<Author>(author_id);
+        std::cout << "Removed " << counts.borrow_records << " borrow records and " << counts.books << " books.\n";
         std::cout << "Author and their books have been deleted successfully.\n";
 
     } catch (const std::exception &e) {
@@ -503,24 +350,28 @@ void removeAuthor(auto &storage) {
     }
 }
 
-void removeBook(auto &storage) {
+void removeBook(auto &storage, CatalogCache<Storage> *catalog) {
     try {
         // List all books
-        listBooks(storage);
+        listBooksFrom(storage, catalog);
         std::cout << "Enter book ID to delete: ";
         int book_id;
-        std::cin >> book_id;
-        // First, remove related borrow records
-        auto borrow_records = storage.template get_all<BorrowRecord>(
-            where(c(&BorrowRecord::book_id) == book_id)
-        );
-        // Delete each borrow record related to this book
-        for (const BorrowRecord &record : borrow_records) {
-            storage.template remove<BorrowRecord>(record.id);
-            std::cout << "Removed BorrowRecord ID: " << record.id << "\n";
-        }
-        // Now, remove the book itself
-        storage.template remove<Book>(book_id);
+        if (!readInt(book_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
+
+        DeleteCounts counts;
+        storage.transaction([&] {
+            counts = deleteBook(storage, book_id);
+            return true;
+        });
+
+        if (counts.books == 0) {
+            std::cout << "Book with ID " << book_id << " not found.\n";
+            return;
+        }
+        std::cout << "Removed " << counts.borrow_records << " borrow records.\n";
         std::cout << "Book deleted successfully.\n";
 
     } catch (const std::exception &e) {
@@ -530,26 +381,98 @@ void removeBook(auto &storage) {
 
 void showBorrowRecords(auto &storage) {
     try {
-        auto borrow_records = storage.template get_all<BorrowRecord>();
-        for (const BorrowRecord &record : borrow_records) {
-            Book book = storage.template get<Book>(record.book_id);
-            Borrower borrower_profile = storage.template get<Borrower>(record.borrower_id);
-            std::cout << "Borrow ID: " << record.id << " || Book: " << book.title << " || Borrower Name: " <<
-                borrower_profile.name << " || Borrowed Date: " << record.borrow_date.value_or("Unknown") <<
-                    " || Return Date: " << record.return_date.value_or("N/A") << "\n";
+        RecordFilter filter;
+        std::cout << "Filter by borrower ID (0 for all): ";
+        if (!readInt(filter.borrower_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
+        std::cout << "Filter by book ID (0 for all): ";
+        if (!readInt(filter.book_id)) {
+            std::cout << "Please enter a number.\n";
+            return;
+        }
+        std::cin.ignore(); // Clear the input buffer
+
+        std::string from, to;
+        std::cout << "Borrowed from (dd-mm-yyyy, leave blank for any): ";
+        std::getline(std::cin, from);
+        std::cout << "Borrowed until (dd-mm-yyyy, leave blank for any): ";
+        std::getline(std::cin, to);
+        if (!from.empty() && !(filter.borrowed_from = parseDate(from))) {
+            std::cout << "Invalid date format. Please enter the date in dd-mm-yyyy format.\n";
+            return;
+        }
+        if (!to.empty() && !(filter.borrowed_to = parseDate(to))) {
+            std::cout << "Invalid date format. Please enter the date in dd-mm-yyyy format.\n";
+            return;
         }
 
+        streamBorrowRecords(storage, filter, std::cout);
     } catch (std::exception &e) {
         std::cerr << "Custom Error: " << e.what() << '\n';
     }
 }
 
+void listOverdueLoans(auto &storage) {
+    try {
+        int count = writeOverdueLoans(storage, today());
+        std::cout << (count ? std::to_string(count) + " overdue loans.\n" : "No overdue loans.\n");
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+    }
+}
+
+void importBooksFromFile(auto &storage) {
+    std::string path;
+    std::cout << "Enter catalog file path (e.g. books.txt): ";
+    std::getline(std::cin, path);
+    runImport(storage, path);
+}
+
+// Per-genre counts, then the books of the genre picked
+void showBooksByGenre(auto &storage) {
+    try {
+        listGenreCounts(storage);
+        std::string genre;
+        std::cout << "Enter genre: ";
+        std::getline(std::cin, genre);
+        if (!listBooksByGenre(storage, genre)) {
+            std::cout << "No genre named '" << genre << "'.\n";
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+    }
+}
+
+void exportCirculationToFile(auto &storage) {
+    std::string path;
+    std::cout << "Enter export file path (leave blank for export_book.txt): ";
+    std::getline(std::cin, path);
+    runExport(storage, path.empty() ? "export_book.txt" : path);
+}
+
+// Slowest statements of the session by total time, when started with --profile-queries, and the catalog
+// cache's hit rate and size, when started with --catalog-cache
+void showDiagnostics(const QueryProfiler *profiler, std::size_t top, const CatalogCache<Storage> *catalog) {
+    if (catalog) {
+        catalog->report(std::cout);
+    }
+    if (!profiler) {
+        std::cout << "Query profiling is off. Start with --profile-queries to record statement latencies.\n";
+        return;
+    }
+    std::cout << "--- Slowest statements (top " << top << " by total time) ---\n";
+    profiler->report(std::cout, top);
+}
+
 void showMain() {
     std::cout << "\n\nLibrary Management System\n";
     std::cout << "1. Manage Books\n";
     std::cout << "2. Manage Authors\n";
     std::cout << "3. Manage Borrowers\n";
     std::cout << "4. Borrow and Return Books\n";
+    std::cout << "5. Diagnostics\n";
     std::cout << "0. Exit\n";
 }
 
@@ -559,6 +482,8 @@ void bookMenu() {
     std::cout << "2. Remove Book\n";
     std::cout << "3. List Books\n";
     std::cout << "4. Update Book\n";
+    std::cout << "5. Import Books from File\n";
+    std::cout << "6. Books by Genre\n";
     std::cout << "0. Back to Main Menu\n";
 }
 
@@ -582,30 +507,37 @@ void borrowReturnMenu() {
     std::cout << "1. Borrow Book\n";
     std::cout << "2. Return Book\n";
     std::cout << "3. Borrow Records\n";
+    std::cout << "4. Overdue Loans\n";
+    std::cout << "5. Export Circulation (CSV)\n";
     std::cout << "0. Back to Main Menu\n";
 }
 
-void handleBookMenu(auto& storage) {
+void handleBookMenu(auto& storage, CatalogCache<Storage> *catalog) {
     int choice;
     while (true) {
         bookMenu();
         std::cout << "Enter choice: ";
-        std::cin >> choice;
-        std::cin.ignore();
+        choice = readChoice();
         std::cout << "\n---------\n";
 
         switch (choice) {
             case 1:
-                addBook(storage);
+                addBook(storage, catalog);
                 break;
             case 2:
-                removeBook(storage);
+                removeBook(storage, catalog);
                 break;
             case 3:
-                listBooks(storage);
+                listBooksFrom(storage, catalog);
                 break;
             case 4:
-                updateBook(storage);
+                updateBook(storage, catalog);
+                break;
+            case 5:
+                importBooksFromFile(storage);
+                break;
+            case 6:
+                showBooksByGenre(storage);
                 break;
             case 0:
                 return;
@@ -621,8 +553,7 @@ void handleAuthorMenu(auto& storage) {
     while (true) {
         authorMenu();
         std::cout << "Enter choice: ";
-        std::cin >> choice;
-        std::cin.ignore();
+        choice = readChoice();
         std::cout << "\n---------\n";
 
         switch (choice) {
@@ -649,8 +580,7 @@ void handleBorrowerMenu(auto& storage) {
     while (true) {
         borrowerMenu();
         std::cout << "Enter choice: ";
-        std::cin >> choice;
-        std::cin.ignore();
+        choice = readChoice();
         std::cout << "\n---------\n";
 
         switch (choice) {
@@ -669,25 +599,30 @@ void handleBorrowerMenu(auto& storage) {
     }
 }
 
-void handleBorrowReturnMenu(auto& storage) {
+void handleBorrowReturnMenu(auto& storage, auto& repo, const LoanPolicy& policy) {
     int choice;
     while (true) {
         borrowReturnMenu();
         std::cout << "Enter choice: ";
-        std::cin >> choice;
-        std::cin.ignore();
+        choice = readChoice();
         std::cout << "\n---------\n";
 
         switch (choice) {
             case 1:
-                borrowBook(storage);
+                borrowBook(storage, repo, policy);
                 break;
             case 2:
-                returnBook(storage);
+                returnBook(storage, repo);
                 break;
             case 3:
                 showBorrowRecords(storage);
                 break;
+            case 4:
+                listOverdueLoans(storage);
+                break;
+            case 5:
+                exportCirculationToFile(storage);
+                break;
             case 0:
                 return;
             default:
@@ -698,28 +633,94 @@ void handleBorrowReturnMenu(auto& storage) {
 }
 
 
-int main() {
-    auto storage = createStorage();
+int main(int argc, char *argv[]) {
+    // Command-line flags (--journal-mode=WAL, --cache-size ...) override the config file.
+    Options options;
+    StorageProfile profile;
+    LoanPolicy policy;
+    // --profile-queries (or "profile_queries = 1" in the config file) times every statement for Diagnostics
+    QueryProfiler profiler;
+    bool profiling = false;
+    std::size_t profileTop = 20;
+    // --catalog-cache keeps books and authors in memory for the menus' listings and lookups
+    bool cataloging = false;
     try {
-        storage.sync_schema();
-        std::cout << "Database schema created successfully.\n";
-        std::cout << "To use this application first create authors and then start adding books" << std::endl;
-        std::cout << "Register Borrowers to use borrow and return features" << std::endl;
+        parseArguments(argc, argv, options);
+        if (options.has("help")) {
+            std::cout << commandUsage;
+            return 0;
+        }
+        std::string configPath = options.get("config", "library.conf");
+        if (!loadConfigFile(configPath, options) && options.has("config")) {
+            std::cerr << "Warning: config file " << configPath << " not found, using defaults.\n";
+        }
+        profile = profileFromOptions(options);
+        policy = loanPolicyFromOptions(options);
+        profiling = options.get("profile_queries", "0") != "0";
+        profileTop = static_cast<std::size_t>(std::max(1LL, options.getInt("profile_top", 20)));
+        cataloging = options.get("catalog_cache", "0") != "0";
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        return 1;
+    }
+
+    auto storage = createStorage(options.get("database", "library.sqlite"));
+    try {
+        openStorage(storage, profile, profiling ? &profiler : nullptr);
+        migrateSchema(storage, policy);
     } catch (const std::exception &e) {
         std::cerr << "Custom Error: " << e.what() << '\n';
+        return 1;
     }
 
+    // Prepared once the tables exist; reused by the circulation functions for the whole session
+    Repository repo(storage);
+
+    // `librarymanagement borrow --book 5 --borrower 3` etc. run one command and exit with its status;
+    // `--batch events.jsonl` applies a whole file of them in grouped transactions and `serve` answers them over
+    // HTTP with connections of its own
+    if (options.has("batch") || !options.positional.empty()) {
+        int status;
+        if (options.has("batch")) {
+            status = runBatch(storage, repo, options, policy);
+        } else if (options.positional[0] == "serve" && options.positional.size() == 1) {
+            status = runServe(options, profile, policy, profiling ? &profiler : nullptr);
+        } else {
+            status = runCommand(storage, repo, options, policy);
+        }
+        if (profiling) {
+            profiler.report(std::cerr, profileTop);
+        }
+        return status;
+    }
+
+    // Only the interactive session talks about its setup, so command output stays clean for scripts
+    std::cout << "Storage profile: " << describeProfile(storage.get_connection().get()) << '\n';
+    std::cout << "Database schema created successfully.\n";
+    std::cout << "To use this application first create authors and then start adding books" << std::endl;
+    std::cout << "Register Borrowers to use borrow and return features" << std::endl;
+
+    std::optional<CatalogCache<Storage>> catalog;
+    if (cataloging) {
+        try {
+            catalog.emplace(storage);
+            catalog->report(std::cout);
+        } catch (const std::exception &e) {
+            std::cerr << "Custom Error: " << e.what() << '\n';
+            return 1;
+        }
+    }
+    CatalogCache<Storage> *cache = catalog ? &*catalog : nullptr;
+
     while (true) {
         showMain();
-        int choice;
         std::cout << "Enter choice: ";
-        std::cin >> choice;
-        std::cin.ignore();
+        int choice = readChoice();
         std::cout << "\n---------\n";
 
         switch (choice) {
             case 1:
-                handleBookMenu(storage);
+                handleBookMenu(storage, cache);
                 break;
             case 2:
                 handleAuthorMenu(storage);
@@ -728,9 +729,18 @@ int main() {
                 handleBorrowerMenu(storage);
                 break;
             case 4:
-                handleBorrowReturnMenu(storage);
+                handleBorrowReturnMenu(storage, repo, policy);
+                break;
+            case 5:
+                showDiagnostics(profiling ? &profiler : nullptr, profileTop, cache);
                 break;
             case 0:
+                if (profiling) {
+                    profiler.report(std::cout, profileTop);
+                }
+                if (cache) {
+                    cache->report(std::cout);
+                }
                 std::cout << "Exiting the program. Goodbye!\n";
                 return 0;
             default:
@@ -0,0 +1,102 @@
+#ifndef LIBRARYMANAGEMENT_MIGRATIONS_H
+#define LIBRARYMANAGEMENT_MIGRATIONS_H
+
+#include "storage.h"
+#include "dates.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Schema version recorded in PRAGMA user_version. Bump it together with a new step in migrateSchema().
+constexpr int schemaVersion = 4;
+
+// Rebuilds `tables` from the current storage definition, for changes sync_schema cannot make in place
+// (constraints, column types). Each table is renamed to <table>_old, sync_schema creates the new one with its
+// indexes, and `copies` (INSERT ... SELECT ... FROM <table>_old) move the rows across. It all runs in one
+// transaction with foreign keys off, following SQLite's table-rebuild procedure, and fails if the copied
+// rows break a foreign key.
+void rebuildTables(auto &storage, const std::vector<std::string> &tables, const std::vector<std::string> &copies) {
+    sqlite3 *db = storage.get_connection().get();
+    executeSql(db, "PRAGMA foreign_keys=OFF");
+    // Keep references in other tables pointing at the original names while the old copies are renamed
+    executeSql(db, "PRAGMA legacy_alter_table=ON");
+    storage.begin_transaction();
+    try {
+        for (const auto &table: tables) {
+            // Index names must be free for sync_schema to recreate them on the new table
+            for (const auto &index: queryColumn(db, "SELECT name FROM sqlite_master WHERE type = 'index' AND "
+                                                    "sql IS NOT NULL AND tbl_name = '" + table + "'")) {
+                executeSql(db, "DROP INDEX \"" + index + "\"");
+            }
+            executeSql(db, "ALTER TABLE \"" + table + "\" RENAME TO \"" + table + "_old\"");
+        }
+        storage.sync_schema();
+        for (const auto &copy: copies) {
+            executeSql(db, copy);
+        }
+        for (const auto &table: tables) {
+            executeSql(db, "DROP TABLE \"" + table + "_old\"");
+        }
+        if (!queryText(db, "PRAGMA foreign_key_check").empty()) {
+            throw std::runtime_error("migrated rows violate a foreign key");
+        }
+        storage.commit();
+    } catch (...) {
+        storage.rollback();
+        executeSql(db, "PRAGMA legacy_alter_table=OFF");
+        executeSql(db, "PRAGMA foreign_keys=ON");
+        throw;
+    }
+    executeSql(db, "PRAGMA legacy_alter_table=OFF");
+    executeSql(db, "PRAGMA foreign_keys=ON");
+}
+
+// Brings a database created by an older build up to schemaVersion, then lets sync_schema create whatever is
+// still missing. New databases are created directly at the current version.
+//
+// Older layouts are upgraded by one rebuild whose copies always target the current layout and are idempotent,
+// so the same statements work whichever version the rows come from:
+//   1: foreign keys with ON DELETE CASCADE; rows that already lost their parent are dropped, as the cascade
+//      would have removed them
+//   2: borrow/return dates as integer epoch days instead of DD-MM-YYYY / YYYY-MM-DD text
+//   4: books.genre text replaced by books.genre_id into the genres table; each distinct non-empty name becomes
+//      one genres row and empty genres become NULL
+// Added nullable columns need no rebuild (sync_schema adds them in place), only a backfill:
+//   3: due_date, backfilled for existing loans from the configured loan period, as a new loan would get
+void migrateSchema(auto &storage, const LoanPolicy &policy) {
+    sqlite3 *db = storage.get_connection().get();
+    int version = std::stoi(queryText(db, "PRAGMA user_version"));
+
+    bool existing = storage.table_exists("books");
+    if (existing && version < schemaVersion) {
+        std::cerr << "Migrating database schema from version " << version << " to " << schemaVersion << "...\n";
+    }
+    if (existing && version < 4) {
+        std::vector<std::string> tables = {"books"};
+        std::vector<std::string> copies = {
+            "INSERT OR IGNORE INTO genres (name) "
+            "SELECT DISTINCT genre FROM books_old WHERE genre IS NOT NULL AND genre <> '' ORDER BY genre",
+            "INSERT INTO books (id, title, author_id, genre_id, is_borrowed) "
+            "SELECT b.id, b.title, b.author_id, g.id, b.is_borrowed FROM books_old b "
+            "LEFT JOIN genres g ON g.name = b.genre "
+            "WHERE b.author_id IN (SELECT id FROM authors)"
+        };
+        if (version < 2) {
+            tables.push_back("borrow_records");
+            copies.push_back("INSERT INTO borrow_records (id, book_id, borrower_id, borrow_date, return_date) "
+                             "SELECT id, book_id, borrower_id, " + epochDaysSql("borrow_date") + ", " +
+                             epochDaysSql("return_date") + " FROM borrow_records_old "
+                             "WHERE book_id IN (SELECT id FROM books) AND borrower_id IN (SELECT id FROM borrowers)");
+        }
+        rebuildTables(storage, tables, copies);
+    }
+
+    storage.sync_schema();
+    if (existing && version < 3) {
+        executeSql(db, "UPDATE borrow_records SET due_date = borrow_date + " + std::to_string(policy.loan_days) +
+                       " WHERE due_date IS NULL");
+    }
+    executeSql(db, "PRAGMA user_version=" + std::to_string(schemaVersion));
+}
+
+#endif //LIBRARYMANAGEMENT_MIGRATIONS_H
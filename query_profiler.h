@@ -0,0 +1,184 @@
+#ifndef LIBRARYMANAGEMENT_QUERY_PROFILER_H
+#define LIBRARYMANAGEMENT_QUERY_PROFILER_H
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Collapses a statement to its shape: string and numeric literals become '?', whitespace runs become one space.
+// "SELECT * FROM books WHERE id = 5" and "... id = 7" then share one histogram.
+inline std::string normalizeSql(const char *sql) {
+    std::string out;
+    bool space = false;
+    for (const char *p = sql; *p;) {
+        unsigned char ch = static_cast<unsigned char>(*p);
+        if (std::isspace(ch)) {
+            space = !out.empty();
+            ++p;
+            continue;
+        }
+        if (space) {
+            out.push_back(' ');
+            space = false;
+        }
+        bool afterIdentifier = !out.empty() && (std::isalnum(static_cast<unsigned char>(out.back())) ||
+                                                out.back() == '_');
+        if (ch == '\'') {
+            for (++p; *p; ++p) {
+                if (*p == '\'' && *++p != '\'') { // '' inside a literal is an escaped quote
+                    break;
+                }
+            }
+            out.push_back('?');
+        } else if (std::isdigit(ch) && !afterIdentifier) {
+            while (std::isalnum(static_cast<unsigned char>(*p)) || *p == '.') {
+                ++p;
+            }
+            out.push_back('?');
+        } else {
+            out.push_back(static_cast<char>(ch));
+            ++p;
+        }
+    }
+    return out;
+}
+
+// Per-statement latency collected through sqlite3_trace_v2(SQLITE_TRACE_PROFILE). Each normalized SQL text
+// gets a histogram with fixed, roughly logarithmic buckets, so memory per statement is constant and recording
+// is a lookup plus an increment. Nothing is registered unless attach() is called, so a connection without a
+// profiler pays nothing. One profiler may be attached to several connections.
+// The time SQLite passes to the profile callback comes from the VFS clock, which is millisecond-grained, so
+// SQLITE_TRACE_STMT stamps the start of each statement with steady_clock and the profile event measures from it.
+class QueryProfiler {
+public:
+    // Upper bounds of the buckets in microseconds; the last bucket takes everything slower
+    static constexpr std::array<std::int64_t, 19> bucketBounds = {
+        1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000
+    };
+
+    struct Histogram {
+        std::array<std::int64_t, bucketBounds.size() + 1> buckets{};
+        std::int64_t calls = 0;
+        std::int64_t total_ns = 0;
+        std::int64_t max_ns = 0;
+
+        void record(std::int64_t ns) {
+            auto bucket = std::lower_bound(bucketBounds.begin(), bucketBounds.end(), (ns + 999) / 1000);
+            ++buckets[static_cast<std::size_t>(bucket - bucketBounds.begin())];
+            ++calls;
+            total_ns += ns;
+            max_ns = std::max(max_ns, ns);
+        }
+
+        // Upper bound (µs) of the bucket holding the p-th quantile, capped at the slowest call seen
+        double quantileUs(double p) const {
+            auto rank = std::max<std::int64_t>(1, static_cast<std::int64_t>(p * static_cast<double>(calls) + 0.5));
+            std::int64_t seen = 0;
+            for (std::size_t i = 0; i < buckets.size(); ++i) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    return i < bucketBounds.size() ? std::min(static_cast<double>(bucketBounds[i]), max_ns / 1000.0)
+                                                   : max_ns / 1000.0;
+                }
+            }
+            return max_ns / 1000.0;
+        }
+    };
+
+    void attach(sqlite3 *db) {
+        sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, &QueryProfiler::onTrace, this);
+    }
+
+    static void detach(sqlite3 *db) {
+        sqlite3_trace_v2(db, 0, nullptr, nullptr);
+    }
+
+    void reset() {
+        std::lock_guard lock(mutex);
+        byText.clear();
+        byShape.clear();
+        started.clear();
+    }
+
+    // The `top` statements by total time spent, with call counts and bucketed p50/p99
+    void report(std::ostream &out, std::size_t top = 20) const {
+        std::vector<std::pair<std::string, Histogram>> rows;
+        {
+            std::lock_guard lock(mutex);
+            rows.assign(byShape.begin(), byShape.end());
+        }
+        std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+            return a.second.total_ns > b.second.total_ns;
+        });
+        if (rows.empty()) {
+            out << "No statements recorded.\n";
+            return;
+        }
+        char line[128];
+        std::snprintf(line, sizeof line, "%10s %12s %10s %10s %10s %10s  %s\n",
+                      "calls", "total ms", "mean us", "p50<= us", "p99<= us", "max us", "statement");
+        out << line;
+        for (std::size_t i = 0; i < rows.size() && i < top; ++i) {
+            const auto &[sql, histogram] = rows[i];
+            std::snprintf(line, sizeof line, "%10lld %12.2f %10.1f %10.0f %10.0f %10.1f  ",
+                          static_cast<long long>(histogram.calls), histogram.total_ns / 1e6,
+                          histogram.total_ns / 1e3 / static_cast<double>(histogram.calls),
+                          histogram.quantileUs(0.50), histogram.quantileUs(0.99), histogram.max_ns / 1e3);
+            out << line << (sql.size() > 100 ? sql.substr(0, 97) + "..." : sql) << '\n';
+        }
+        if (rows.size() > top) {
+            out << "(" << rows.size() - top << " more statements not shown)\n";
+        }
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static int onTrace(unsigned event, void *context, void *statement, void *detail) {
+        auto *self = static_cast<QueryProfiler *>(context);
+        auto *stmt = static_cast<sqlite3_stmt *>(statement);
+        if (event == SQLITE_TRACE_STMT) {
+            // Trigger programs report again for the same statement with a "-- trigger" text; keep the first stamp
+            if (std::string_view(static_cast<const char *>(detail)).substr(0, 2) != "--") {
+                std::lock_guard lock(self->mutex);
+                self->started.insert_or_assign(stmt, Clock::now());
+            }
+        } else if (const char *sql = sqlite3_sql(stmt)) {
+            self->record(stmt, sql, *static_cast<sqlite3_int64 *>(detail));
+        }
+        return 0;
+    }
+
+    void record(sqlite3_stmt *stmt, const char *sql, std::int64_t reported_ns) {
+        auto now = Clock::now();
+        std::lock_guard lock(mutex);
+        std::int64_t ns = reported_ns;
+        if (auto start = started.find(stmt); start != started.end()) {
+            ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start->second).count();
+            started.erase(start);
+        }
+        // Prepared statements repeat the same text, so the normalization runs once per distinct text
+        auto it = byText.find(sql);
+        if (it == byText.end()) {
+            it = byText.emplace(sql, &byShape[normalizeSql(sql)]).first;
+        }
+        it->second->record(ns);
+    }
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Histogram> byShape;
+    std::unordered_map<std::string, Histogram *> byText; // raw SQL text -> its shape's histogram
+    std::unordered_map<sqlite3_stmt *, Clock::time_point> started; // statements currently running
+};
+
+#endif //LIBRARYMANAGEMENT_QUERY_PROFILER_H
@@ -0,0 +1,109 @@
+#ifndef LIBRARYMANAGEMENT_REPOSITORY_H
+#define LIBRARYMANAGEMENT_REPOSITORY_H
+
+#include "storage.h"
+#include <optional>
+#include <vector>
+#include <utility>
+
+// Query shapes of the hot circulation lookups. The literal 0s are placeholders that are re-bound before each run.
+namespace queries {
+    using namespace sqlite_orm;
+
+    template<class T>
+    auto byId() {
+        return get_optional<T>(0);
+    }
+
+    inline auto loansByBook() {
+        return get_all<BorrowRecord>(where(c(&BorrowRecord::book_id) == 0));
+    }
+
+    inline auto loansByBorrower() {
+        return get_all<BorrowRecord>(where(c(&BorrowRecord::borrower_id) == 0));
+    }
+
+    inline auto openLoanOfBook() {
+        return get_all<BorrowRecord>(where(c(&BorrowRecord::book_id) == 0 and is_null(&BorrowRecord::return_date)));
+    }
+}
+
+template<class S, class Expression>
+using PreparedStatement = decltype(std::declval<S &>().prepare(std::declval<Expression>()));
+
+// Statements prepared once on the storage's connection and re-bound on every call, so the hot paths
+// skip SQL serialization and sqlite3_prepare. Requires a storage kept open with openStorage().
+template<class S>
+class Repository {
+public:
+    S &storage;
+
+    explicit Repository(S &storage)
+        : storage(storage),
+          bookById(storage.prepare(queries::byId<Book>())),
+          authorById(storage.prepare(queries::byId<Author>())),
+          borrowerById(storage.prepare(queries::byId<Borrower>())),
+          genreById(storage.prepare(queries::byId<Genre>())),
+          borrowRecordById(storage.prepare(queries::byId<BorrowRecord>())),
+          loansByBookStmt(storage.prepare(queries::loansByBook())),
+          loansByBorrowerStmt(storage.prepare(queries::loansByBorrower())),
+          openLoanOfBookStmt(storage.prepare(queries::openLoanOfBook())) {
+    }
+
+    std::optional<Book> book(int id) {
+        sqlite_orm::get<0>(bookById) = id;
+        return storage.execute(bookById);
+    }
+
+    std::optional<Author> author(int id) {
+        sqlite_orm::get<0>(authorById) = id;
+        return storage.execute(authorById);
+    }
+
+    std::optional<Borrower> borrower(int id) {
+        sqlite_orm::get<0>(borrowerById) = id;
+        return storage.execute(borrowerById);
+    }
+
+    std::optional<Genre> genre(int id) {
+        sqlite_orm::get<0>(genreById) = id;
+        return storage.execute(genreById);
+    }
+
+    std::optional<BorrowRecord> borrowRecord(int id) {
+        sqlite_orm::get<0>(borrowRecordById) = id;
+        return storage.execute(borrowRecordById);
+    }
+
+    std::vector<BorrowRecord> loansByBook(int bookId) {
+        sqlite_orm::get<0>(loansByBookStmt) = bookId;
+        return storage.execute(loansByBookStmt);
+    }
+
+    std::vector<BorrowRecord> loansByBorrower(int borrowerId) {
+        sqlite_orm::get<0>(loansByBorrowerStmt) = borrowerId;
+        return storage.execute(loansByBorrowerStmt);
+    }
+
+    // At most one row while the books.is_borrowed flag and the loans agree.
+    std::optional<BorrowRecord> openLoanOfBook(int bookId) {
+        sqlite_orm::get<0>(openLoanOfBookStmt) = bookId;
+        auto loans = storage.execute(openLoanOfBookStmt);
+        if (loans.empty()) {
+            return std::nullopt;
+        }
+        return loans.front();
+    }
+
+private:
+    PreparedStatement<S, decltype(queries::byId<Book>())> bookById;
+    PreparedStatement<S, decltype(queries::byId<Author>())> authorById;
+    PreparedStatement<S, decltype(queries::byId<Borrower>())> borrowerById;
+    PreparedStatement<S, decltype(queries::byId<Genre>())> genreById;
+    PreparedStatement<S, decltype(queries::byId<BorrowRecord>())> borrowRecordById;
+    PreparedStatement<S, decltype(queries::loansByBook())> loansByBookStmt;
+    PreparedStatement<S, decltype(queries::loansByBorrower())> loansByBorrowerStmt;
+    PreparedStatement<S, decltype(queries::openLoanOfBook())> openLoanOfBookStmt;
+};
+
+#endif //LIBRARYMANAGEMENT_REPOSITORY_H
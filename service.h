@@ -0,0 +1,296 @@
+#ifndef LIBRARYMANAGEMENT_SERVICE_H
+#define LIBRARYMANAGEMENT_SERVICE_H
+
+#include "storage.h"
+#include "repository.h"
+#include "library.h"
+#include "commands.h"
+#include "dates.h"
+#include "json.h"
+#include "http.h"
+#include "concurrency.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// JSON endpoints over the library operations, for `librarymanagement serve --port 8080 [--threads N]`:
+//     GET    /books?after=ID&limit=N[&genre=G]   GET /books/{id}   POST /books   PUT /books/{id}   DELETE /books/{id}
+//     GET    /authors?after=&limit=     GET /authors/{id}   POST /authors   DELETE /authors/{id}
+//     GET    /borrowers?after=&limit=   GET /borrowers/{id} POST /borrowers
+//     GET    /loans?book=ID | ?borrower=ID | ?after=&limit= (open loans)     GET /overdue?limit=N
+//     POST   /borrow {"book": 5, "borrower": 3}             POST /return {"book": 5} or {"record": 12}
+//     GET    /genres (with the number of books in each)
+// Request bodies carry the same fields as the command-line flags and go through applyMutation(), so every
+// front end enforces the same rules. Refusals answer 409, bad arguments 400. GETs run on a pool of read-only
+// connections; every write is queued to the single writer thread (concurrency.h), which commits them in groups.
+
+// `genre` is the name behind book.genre_id, "" for none
+inline std::string bookJson(const Book &book, const std::string &genre) {
+    return "{\"id\":" + std::to_string(book.id) + ",\"title\":" + jsonString(book.title) +
+           ",\"author_id\":" + std::to_string(book.author_id) + ",\"genre\":" + jsonString(genre) +
+           ",\"is_borrowed\":" + (book.is_borrowed ? "true" : "false") + "}";
+}
+
+inline std::string authorJson(const Author &author) {
+    return "{\"id\":" + std::to_string(author.id) + ",\"name\":" + jsonString(author.name) + "}";
+}
+
+inline std::string borrowerJson(const Borrower &borrower) {
+    return "{\"id\":" + std::to_string(borrower.id) + ",\"name\":" + jsonString(borrower.name) +
+           ",\"email\":" + jsonString(borrower.email) + "}";
+}
+
+inline std::string loanJson(const BorrowRecord &record) {
+    auto date = [](const std::optional<int> &days) {
+        return days ? "\"" + formatIsoDate(*days) + "\"" : std::string("null");
+    };
+    return "{\"id\":" + std::to_string(record.id) + ",\"book_id\":" + std::to_string(record.book_id) +
+           ",\"borrower_id\":" + std::to_string(record.borrower_id) + ",\"borrow_date\":" +
+           date(record.borrow_date) + ",\"due_date\":" + date(record.due_date) +
+           ",\"return_date\":" + date(record.return_date) + "}";
+}
+
+template<class T, class ToJson>
+std::string jsonArray(const std::vector<T> &items, ToJson toJson) {
+    std::string out = "[";
+    for (const auto &item: items) {
+        out += (out.size() > 1 ? "," : "") + toJson(item);
+    }
+    return out + "]";
+}
+
+inline HttpResponse jsonError(int status, const std::string &message) {
+    return {status, "{\"ok\":false,\"error\":" + jsonString(message) + "}"};
+}
+
+// Whole positive number from a path segment or query parameter; nullopt when absent or malformed
+inline std::optional<int> parseId(std::string_view text) {
+    int value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (text.empty() || error != std::errc() || end != text.data() + text.size() || value <= 0) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// Keyset paging over ids: rows with id > after, at most `limit` (1..1000, default 100)
+struct Page {
+    int after = 0;
+    int limit = 100;
+};
+
+inline Page pageOf(const HttpRequest &request) {
+    Page page;
+    page.after = parseId(request.param("after")).value_or(0);
+    page.limit = std::min(parseId(request.param("limit")).value_or(page.limit), 1000);
+    return page;
+}
+
+// The command a write request stands for, or nullopt when the request only reads
+inline std::optional<std::vector<std::string>> mutationOf(const std::string &method, const std::string &resource,
+                                                          bool hasId) {
+    if (method == "POST" && !hasId && (resource == "books" || resource == "authors" || resource == "borrowers")) {
+        return std::vector<std::string>{"add", resource.substr(0, resource.size() - 1)};
+    }
+    if ((method == "PUT" || method == "PATCH") && hasId && resource == "books") {
+        return std::vector<std::string>{"update", "book"};
+    }
+    if (method == "DELETE" && hasId && (resource == "books" || resource == "authors")) {
+        return std::vector<std::string>{"remove", resource.substr(0, resource.size() - 1)};
+    }
+    if (method == "POST" && !hasId && (resource == "borrow" || resource == "return")) {
+        return std::vector<std::string>{resource};
+    }
+    return std::nullopt;
+}
+
+// Answers a GET on one reader connection
+HttpResponse readResource(auto &storage, auto &repo, const HttpRequest &request, const std::string &resource,
+                          std::optional<int> id) {
+    auto found = [](const auto &row, auto toJson) {
+        return row ? HttpResponse{200, toJson(*row)} : jsonError(404, "not found");
+    };
+    // Genre names are few and looked up by primary key through a prepared statement
+    auto bookWithGenre = [&repo](const Book &book) {
+        auto genre = book.genre_id ? repo.genre(*book.genre_id) : std::nullopt;
+        return bookJson(book, genre ? genre->name : "");
+    };
+    Page page = pageOf(request);
+
+    if (resource == "books" && id) {
+        return found(repo.book(*id), bookWithGenre);
+    }
+    if (resource == "books" && !request.param("genre").empty()) {
+        auto genres = storage.select(&Genre::id, where(c(&Genre::name) == request.param("genre")));
+        if (genres.empty()) {
+            return jsonError(404, "no such genre");
+        }
+        return {200, jsonArray<Book>(storage.template get_all<Book>(where(c(&Book::genre_id) == genres.front() and
+                                                                           c(&Book::id) > page.after),
+                                                                     order_by(&Book::id), limit(page.limit)),
+                                     bookWithGenre)};
+    }
+    if (resource == "books") {
+        return {200, jsonArray<Book>(storage.template get_all<Book>(where(c(&Book::id) > page.after),
+                                                                     order_by(&Book::id), limit(page.limit)),
+                                     bookWithGenre)};
+    }
+    if (resource == "genres" && !id) {
+        std::map<std::optional<int>, int> counts;
+        for (auto &&[genre_id, books]: storage.select(columns(&Book::genre_id, count<Book>()),
+                                                      group_by(&Book::genre_id))) {
+            counts[genre_id] = books;
+        }
+        return {200, jsonArray<Genre>(storage.template get_all<Genre>(order_by(&Genre::name)),
+                                      [&counts](const Genre &genre) {
+                                          return "{\"id\":" + std::to_string(genre.id) + ",\"name\":" +
+                                                 jsonString(genre.name) + ",\"books\":" +
+                                                 std::to_string(counts[genre.id]) + "}";
+                                      })};
+    }
+    if (resource == "authors" && id) {
+        return found(repo.author(*id), authorJson);
+    }
+    if (resource == "authors") {
+        return {200, jsonArray<Author>(storage.template get_all<Author>(where(c(&Author::id) > page.after),
+                                                                         order_by(&Author::id), limit(page.limit)),
+                                       authorJson)};
+    }
+    if (resource == "borrowers" && id) {
+        return found(repo.borrower(*id), borrowerJson);
+    }
+    if (resource == "borrowers") {
+        return {200, jsonArray<Borrower>(storage.template get_all<Borrower>(where(c(&Borrower::id) > page.after),
+                                                                             order_by(&Borrower::id),
+                                                                             limit(page.limit)),
+                                         borrowerJson)};
+    }
+    if (resource == "loans" && !id) {
+        if (auto book = parseId(request.param("book"))) {
+            return {200, jsonArray<BorrowRecord>(repo.loansByBook(*book), loanJson)};
+        }
+        if (auto borrower = parseId(request.param("borrower"))) {
+            return {200, jsonArray<BorrowRecord>(repo.loansByBorrower(*borrower), loanJson)};
+        }
+        return {200, jsonArray<BorrowRecord>(storage.template get_all<BorrowRecord>(
+                                                 where(is_null(&BorrowRecord::return_date) and
+                                                       c(&BorrowRecord::id) > page.after),
+                                                 order_by(&BorrowRecord::id), limit(page.limit)),
+                                             loanJson)};
+    }
+    if (resource == "overdue" && !id) {
+        return {200, jsonArray<BorrowRecord>(storage.template get_all<BorrowRecord>(
+                                                 where(is_null(&BorrowRecord::return_date) and
+                                                       c(&BorrowRecord::due_date) < today()),
+                                                 order_by(&BorrowRecord::due_date), limit(page.limit)),
+                                             loanJson)};
+    }
+    if (resource == "health") {
+        return {200, R"({"ok":true})"};
+    }
+    return jsonError(404, "no such endpoint");
+}
+
+// Reads run on a pooled read-only connection; writes are queued to the writer thread and waited for.
+inline HttpResponse routeRequest(LibraryAccess &library, const HttpRequest &request) {
+    std::vector<std::string> segments;
+    for (std::size_t begin = 1; begin <= request.path.size();) {
+        auto end = std::min(request.path.find('/', begin), request.path.size());
+        if (end > begin) {
+            segments.push_back(request.path.substr(begin, end - begin));
+        }
+        begin = end + 1;
+    }
+    if (segments.empty() || segments.size() > 2) {
+        return jsonError(404, "no such endpoint");
+    }
+    const std::string &resource = segments[0];
+    std::optional<int> id;
+    if (segments.size() == 2 && !(id = parseId(segments[1]))) {
+        return jsonError(404, "no such " + resource + " id");
+    }
+
+    if (auto words = mutationOf(request.method, resource, id.has_value())) {
+        Options command = request.body.empty() ? Options{} : parseJsonObject(request.body);
+        command.positional = std::move(*words);
+        if (id) {
+            command.values["id"] = std::to_string(*id);
+        }
+        bool adding = command.positional[0] == "add";
+        CommandResult result = library.writer.submit(std::move(command)).get();
+        if (result.status != ExitOk) {
+            return jsonError(409, result.message);
+        }
+        return {adding ? 201 : 200, "{\"ok\":true,\"message\":" + jsonString(result.message) + "}"};
+    }
+    if (request.method != "GET") {
+        return jsonError(405, request.method + " is not supported on " + request.path);
+    }
+    return library.readers.read([&](auto &storage, auto &repo) {
+        return readResource(storage, repo, request, resource, id);
+    });
+}
+
+// Handlers for HttpServer's workers, all sharing one reader pool (a connection per worker) and one writer.
+inline std::function<HttpServer::Handler()> serviceHandlers(const std::string &path, const StorageProfile &profile,
+                                                            const LoanPolicy &policy, int workers,
+                                                            const CommitWindow &window = {},
+                                                            QueryProfiler *profiler = nullptr) {
+    auto library = std::make_shared<LibraryAccess>(path, profile, policy, workers, window, profiler);
+    return [library] {
+        return HttpServer::Handler([library](const HttpRequest &request) {
+            try {
+                return routeRequest(*library, request);
+            } catch (const std::invalid_argument &e) {
+                return jsonError(400, e.what());
+            } catch (const std::exception &e) {
+                return jsonError(409, e.what());
+            }
+        });
+    };
+}
+
+// Set from SIGINT / SIGTERM; `serve` polls it so it can shut down cleanly and the caller's reports still print
+inline volatile std::sig_atomic_t serveStopRequested = 0;
+
+inline void requestServeStop(int) {
+    serveStopRequested = 1;
+}
+
+// `serve [--port 8080] [--threads N] [--commit-window-ms 2] [--commit-max-ops 256]`: listens on 127.0.0.1 until
+// interrupted, then finishes the requests in flight and commits the queued writes. With a profiler, the reader
+// and writer connections report their statements to it.
+inline int runServe(const Options &options, const StorageProfile &profile, const LoanPolicy &policy,
+                    QueryProfiler *profiler = nullptr) {
+    try {
+        int port = static_cast<int>(options.getInt("port", 8080));
+        int threads = static_cast<int>(options.getInt("threads", std::max(2u, std::thread::hardware_concurrency())));
+        HttpServer server(port, threads, serviceHandlers(options.get("database", "library.sqlite"), profile, policy,
+                                                         threads, commitWindowFromOptions(options), profiler));
+        server.start();
+        std::cout << "Serving on http://127.0.0.1:" << server.port() << " with " << threads << " workers.\n"
+                  << std::flush;
+        std::signal(SIGINT, requestServeStop);
+        std::signal(SIGTERM, requestServeStop);
+        while (!serveStopRequested) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        server.stop();
+        std::cout << "Stopped.\n";
+        return ExitOk;
+    } catch (const std::exception &e) {
+        std::cerr << "Custom Error: " << e.what() << '\n';
+        return ExitRefused;
+    }
+}
+
+#endif //LIBRARYMANAGEMENT_SERVICE_H
@@ -0,0 +1,288 @@
+#ifndef LIBRARYMANAGEMENT_STORAGE_H
+#define LIBRARYMANAGEMENT_STORAGE_H
+
+#include "sqlite_orm/sqlite_orm.h"
+#include "config.h"
+#include "query_profiler.h"
+#include <string>
+#include <optional>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+#include <cctype>
+
+// Entities
+struct Book {
+    int id;
+    std::string title;
+    int author_id;
+    std::optional<int> genre_id;      // genres.id; null when the book has no genre
+    bool is_borrowed;
+};
+
+// Genre names are stored once and referenced by id, so books rows stay small and genre filters compare integers
+struct Genre {
+    int id;
+    std::string name;
+};
+
+struct Author {
+    int id;
+    std::string name;
+};
+
+struct Borrower {
+    int id;
+    std::string name;
+    std::string email;
+};
+
+struct BorrowRecord {
+    int id;
+    int book_id;
+    int borrower_id;
+    std::optional<int> borrow_date;   // days since 1970-01-01, see dates.h
+    std::optional<int> return_date;
+    std::optional<int> due_date;
+};
+
+// Storage setup
+inline auto createStorage(const std::string &path = "library.sqlite") {
+    using namespace sqlite_orm;
+
+    // Indexes are listed before the tables so sync_schema creates them after the tables exist.
+    return make_storage(path,
+                        // Loans of a book (returnBook, removeBook, removeAuthor)
+                        make_index("idx_borrow_records_book_id", &BorrowRecord::book_id),
+                        // Loans of a borrower (listBorrowers)
+                        make_index("idx_borrow_records_borrower_id", &BorrowRecord::borrower_id),
+                        // Open loans only: stays small no matter how long the history grows
+                        make_index("idx_borrow_records_open", &BorrowRecord::book_id,
+                                   where(is_null(&BorrowRecord::return_date))),
+                        // Overdue report: open loans ordered by due date, sized by open loans rather than history
+                        make_index("idx_borrow_records_overdue", &BorrowRecord::due_date,
+                                   where(is_null(&BorrowRecord::return_date))),
+                        // Date-range reports over the borrow history
+                        make_index("idx_borrow_records_borrow_date", &BorrowRecord::borrow_date),
+                        // Books of an author (listAuthorsAndBooks, removeAuthor)
+                        make_index("idx_books_author_id", &Book::author_id),
+                        // Books of a genre and per-genre counts (listBooksByGenre, listGenreCounts)
+                        make_index("idx_books_genre_id", &Book::genre_id),
+                        make_table("books",
+                                   make_column("id", &Book::id, primary_key().autoincrement()),
+                                   make_column("title", &Book::title),
+                                   make_column("author_id", &Book::author_id),
+                                   make_column("genre_id", &Book::genre_id),
+                                   make_column("is_borrowed", &Book::is_borrowed),
+                                   foreign_key(&Book::author_id).references(&Author::id).on_delete.cascade(),
+                                   foreign_key(&Book::genre_id).references(&Genre::id)),
+                        make_table("authors",
+                                   make_column("id", &Author::id, primary_key().autoincrement()),
+                                   make_column("name", &Author::name)),
+                        make_table("borrowers",
+                                   make_column("id", &Borrower::id, primary_key().autoincrement()),
+                                   make_column("name", &Borrower::name),
+                                   make_column("email", &Borrower::email)),
+                        make_table("borrow_records",
+                                   make_column("id", &BorrowRecord::id, primary_key().autoincrement()),
+                                   make_column("book_id", &BorrowRecord::book_id),
+                                   make_column("borrower_id", &BorrowRecord::borrower_id),
+                                   make_column("borrow_date", &BorrowRecord::borrow_date),
+                                   make_column("return_date", &BorrowRecord::return_date),
+                                   make_column("due_date", &BorrowRecord::due_date),
+                                   foreign_key(&BorrowRecord::book_id).references(&Book::id).on_delete.cascade(),
+                                   foreign_key(&BorrowRecord::borrower_id).references(&Borrower::id).on_delete.cascade()),
+                        make_table("genres",
+                                   make_column("id", &Genre::id, primary_key().autoincrement()),
+                                   make_column("name", &Genre::name, unique())));
+}
+
+// The storage type, for code that keeps a storage as a member (one per worker thread)
+using Storage = decltype(createStorage());
+
+// Raw connection helpers, for statements sqlite_orm has no builder for (pragmas, migrations).
+inline void executeSql(sqlite3 *db, const std::string &sql) {
+    char *error = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK) {
+        std::string message = error ? error : sqlite3_errmsg(db);
+        sqlite3_free(error);
+        throw std::runtime_error(message + " (" + sql + ")");
+    }
+}
+
+// A raw prepared statement, for bulk paths that re-bind one statement millions of times.
+class Statement {
+public:
+    Statement(sqlite3 *db, const std::string &sql) : db(db) {
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            throw std::runtime_error(std::string(sqlite3_errmsg(db)) + " (" + sql + ")");
+        }
+    }
+
+    ~Statement() {
+        sqlite3_finalize(stmt);
+    }
+
+    Statement(const Statement &) = delete;
+    Statement &operator=(const Statement &) = delete;
+
+    // Parameters are 1-based. Text is bound without copying and must stay alive until the next step().
+    Statement &bind(int index, long long value) {
+        check(sqlite3_bind_int64(stmt, index, value));
+        return *this;
+    }
+
+    Statement &bind(int index, const std::string &value) {
+        check(sqlite3_bind_text(stmt, index, value.data(), static_cast<int>(value.size()), SQLITE_STATIC));
+        return *this;
+    }
+
+    Statement &bind(int index, const std::optional<int> &value) {
+        check(value ? sqlite3_bind_int64(stmt, index, *value) : sqlite3_bind_null(stmt, index));
+        return *this;
+    }
+
+    // true while there is a row to read, false once the statement is done
+    bool step() {
+        int rc = sqlite3_step(stmt);
+        if (rc == SQLITE_ROW) {
+            return true;
+        }
+        if (rc != SQLITE_DONE) {
+            throw std::runtime_error(sqlite3_errmsg(db));
+        }
+        return false;
+    }
+
+    // Ready for the next set of bindings
+    void reset() {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+
+    int columnCount() const {
+        return sqlite3_column_count(stmt);
+    }
+
+    std::string columnName(int column) const {
+        return sqlite3_column_name(stmt, column);
+    }
+
+    bool isNull(int column) const {
+        return sqlite3_column_type(stmt, column) == SQLITE_NULL;
+    }
+
+    long long columnInt(int column) const {
+        return sqlite3_column_int64(stmt, column);
+    }
+
+    // Columns are 0-based; NULL reads as "".
+    std::string columnText(int column) const {
+        auto text = sqlite3_column_text(stmt, column);
+        return text ? std::string(reinterpret_cast<const char *>(text), sqlite3_column_bytes(stmt, column)) : "";
+    }
+
+private:
+    void check(int rc) const {
+        if (rc != SQLITE_OK) {
+            throw std::runtime_error(sqlite3_errmsg(db));
+        }
+    }
+
+    sqlite3 *db;
+    sqlite3_stmt *stmt = nullptr;
+};
+
+// First column of the first row returned by `sql`, as text ("" when there is no row).
+inline std::string queryText(sqlite3 *db, const std::string &sql) {
+    Statement stmt(db, sql);
+    return stmt.step() ? stmt.columnText(0) : "";
+}
+
+// Every row of the first column returned by `sql`, as text.
+inline std::vector<std::string> queryColumn(sqlite3 *db, const std::string &sql) {
+    Statement stmt(db, sql);
+    std::vector<std::string> result;
+    while (stmt.step()) {
+        result.push_back(stmt.columnText(0));
+    }
+    return result;
+}
+
+// Connection settings applied every time the storage opens its connection.
+// The defaults trade the rollback journal and per-commit FULL fsyncs for WAL with NORMAL sync,
+// which stays durable against application crashes and only risks the last commits on power loss.
+struct StorageProfile {
+    std::string journal_mode = "WAL";
+    std::string synchronous = "NORMAL";
+    long long cache_size = -65536;        // negative: KiB, so 64 MiB of page cache
+    long long mmap_size = 268435456;      // 256 MiB memory-mapped I/O
+    std::string temp_store = "MEMORY";
+    long long busy_timeout = 5000;        // ms to wait on a locked database before SQLITE_BUSY
+};
+
+inline std::string checkedChoice(const Options &options, const std::string &key, const std::string &fallback,
+                                 const std::set<std::string> &allowed) {
+    std::string value = options.get(key, fallback);
+    std::transform(value.begin(), value.end(), value.begin(), ::toupper);
+    if (!allowed.contains(value)) {
+        throw std::invalid_argument("Unsupported " + key + " '" + value + "'");
+    }
+    return value;
+}
+
+inline StorageProfile profileFromOptions(const Options &options) {
+    StorageProfile profile;
+    profile.journal_mode = checkedChoice(options, "journal_mode", profile.journal_mode,
+                                         {"WAL", "DELETE", "TRUNCATE", "PERSIST", "MEMORY", "OFF"});
+    profile.synchronous = checkedChoice(options, "synchronous", profile.synchronous,
+                                        {"OFF", "NORMAL", "FULL", "EXTRA"});
+    profile.cache_size = options.getInt("cache_size", profile.cache_size);
+    profile.mmap_size = options.getInt("mmap_size", profile.mmap_size);
+    profile.temp_store = checkedChoice(options, "temp_store", profile.temp_store, {"DEFAULT", "FILE", "MEMORY"});
+    profile.busy_timeout = options.getInt("busy_timeout", profile.busy_timeout);
+    return profile;
+}
+
+inline void applyProfile(sqlite3 *db, const StorageProfile &profile) {
+    sqlite3_busy_timeout(db, static_cast<int>(profile.busy_timeout));
+    executeSql(db, "PRAGMA journal_mode=" + profile.journal_mode);
+    executeSql(db, "PRAGMA synchronous=" + profile.synchronous);
+    executeSql(db, "PRAGMA cache_size=" + std::to_string(profile.cache_size));
+    executeSql(db, "PRAGMA mmap_size=" + std::to_string(profile.mmap_size));
+    executeSql(db, "PRAGMA temp_store=" + profile.temp_store);
+}
+
+// Installs the profile and keeps one connection open for the storage's lifetime;
+// without open_forever sqlite_orm reopens the file (and re-reads the schema) for every call.
+// A profiler, when given, is attached to the connection before anything runs on it.
+void openStorage(auto &storage, const StorageProfile &profile, QueryProfiler *profiler = nullptr) {
+    storage.on_open = [profile, profiler](sqlite3 *db) {
+        if (profiler) {
+            profiler->attach(db);
+        }
+        applyProfile(db, profile);
+        // Not a tuning knob: SQLite enforces (and cascades) foreign keys only when asked, per connection
+        executeSql(db, "PRAGMA foreign_keys=ON");
+    };
+    storage.open_forever();
+}
+
+// The settings SQLite actually reports for the connection, e.g. an in-memory database stays in "memory" mode.
+inline std::string describeProfile(sqlite3 *db) {
+    static const char *syncNames[] = {"OFF", "NORMAL", "FULL", "EXTRA"};
+    static const char *tempStoreNames[] = {"DEFAULT", "FILE", "MEMORY"};
+    int sync = std::stoi(queryText(db, "PRAGMA synchronous"));
+    int tempStore = std::stoi(queryText(db, "PRAGMA temp_store"));
+
+    std::ostringstream out;
+    out << "journal_mode=" << queryText(db, "PRAGMA journal_mode")
+        << ", synchronous=" << (sync >= 0 && sync <= 3 ? syncNames[sync] : "?")
+        << ", cache_size=" << queryText(db, "PRAGMA cache_size")
+        << ", mmap_size=" << queryText(db, "PRAGMA mmap_size")
+        << ", temp_store=" << (tempStore >= 0 && tempStore <= 2 ? tempStoreNames[tempStore] : "?")
+        << ", busy_timeout=" << queryText(db, "PRAGMA busy_timeout") << "ms";
+    return out.str();
+}
+
+#endif //LIBRARYMANAGEMENT_STORAGE_H